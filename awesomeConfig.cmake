@@ -143,6 +143,7 @@ set(AWESOME_DEPENDENCIES
     xcb-xtest
     xcb-xinerama
     xcb-shape
+    xcb-shm
     xcb-util
     xcb-util>=0.3.8
     xcb-keysyms
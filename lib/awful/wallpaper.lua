@@ -137,7 +137,7 @@ local cairo      = require( "lgi" ).cairo
 local draw       = require( "wibox.widget" ).draw_to_cairo_context
 local grect      = require( "gears.geometry" ).rectangle
 
-local capi = { screen = screen, root = root }
+local capi = { screen = screen, root = root, awesome = awesome }
 
 local module = {}
 
@@ -297,7 +297,14 @@ local function paint()
         return
     end
 
+    -- Only the screens of the walls change when the old wallpaper was copied,
+    -- drawables elsewhere are not redrawn.
+    local areas = {}
+
     for wall in pairs(walls) do
+        for _, s in ipairs(wall.screens) do
+            table.insert(areas, s.geometry)
+        end
 
         local geo = type(wall._private.panning_area) == "function" and
             wall._private.panning_area(wall) or
@@ -365,13 +372,13 @@ local function paint()
 
     -- Set the wallpaper.
     local pattern = cairo.Pattern.create_for_surface(target)
-    capi.root.wallpaper(pattern)
-
-    -- Limit some potential GC induced increase in memory usage.
-    -- But really, is someone is trying to apply wallpaper changes more
-    -- often than the GC is executed, they are doing it wrong.
-    target:finish()
 
+    -- The wallpaper is painted from the main loop, which keeps its own
+    -- reference to the pattern until it is done, so the surface can only be
+    -- finished right away when it was not taken.
+    if not capi.root.wallpaper(pattern, source and areas) then
+        target:finish()
+    end
 end
 
 local mutex = false
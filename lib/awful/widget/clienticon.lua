@@ -38,18 +38,27 @@ function clienticon:draw(_, cr, width, height)
         return
     end
 
-    local index, size = find_best_icon(c.icon_sizes, width, height)
-    if not index then
+    -- Scale the icon to its size in device pixels, so that it stays sharp
+    -- on HiDPI screens, and draw it back at the scale of cr.
+    local x_dx, x_dy = cr:user_to_device_distance(1, 0)
+    local y_dx, y_dy = cr:user_to_device_distance(0, 1)
+    local scale_x = math.sqrt(x_dx * x_dx + x_dy * x_dy)
+    local scale_y = math.sqrt(y_dx * y_dx + y_dy * y_dy)
+
+    -- The client keeps the scaled icon around, redraws at the same size do
+    -- not scale it again.
+    width, height = math.floor(width * scale_x), math.floor(height * scale_y)
+    if width < 1 or height < 1 then
         return
     end
 
-    local aspect_w = width / size[1]
-    local aspect_h = height / size[2]
-    local aspect = math.min(aspect_w, aspect_h)
-    cr:scale(aspect, aspect)
+    local icon = c:get_scaled_icon(width, height)
+    if not icon then
+        return
+    end
 
-    local s = surface(c:get_icon(index))
-    cr:set_source_surface(s, 0, 0)
+    cr:scale(1 / scale_x, 1 / scale_y)
+    cr:set_source_surface(surface(icon), 0, 0)
     cr:paint()
 end
 
@@ -55,8 +55,11 @@ function wallpaper.prepare_context(s)
         timer.delayed_call(function()
             local paper = pending_wallpaper
             pending_wallpaper = nil
-            wallpaper.set(paper.surface)
-            paper.surface:finish()
+            -- The wallpaper is painted from the main loop, which keeps its
+            -- own reference to the surface until it is done
+            if not wallpaper.set(paper.surface) then
+                paper.surface:finish()
+            end
         end)
     elseif root_width > pending_wallpaper.width or root_height > pending_wallpaper.height then
         -- The root window was resized while a wallpaper is pending
@@ -96,6 +99,7 @@ end
 --- Set the current wallpaper.
 -- @param pattern The wallpaper that should be set. This can be a cairo surface,
 --   a description for gears.color or a cairo pattern.
+-- @treturn boolean Whether the wallpaper is being set.
 -- @see gears.color
 -- @deprecated gears.wallpaper.set
 function wallpaper.set(pattern)
@@ -110,7 +114,7 @@ function wallpaper.set(pattern)
     if not cairo.Pattern:is_type_of(pattern) then
         error("wallpaper.set() called with an invalid argument")
     end
-    root.wallpaper(pattern)
+    return root.wallpaper(pattern)
 end
 
 --- Set a centered wallpaper.
@@ -111,9 +111,14 @@ local function do_redraw(self)
     if self._dirty_area:is_empty() then
         return
     end
+    -- Only the dirty area has to be copied to the screen afterwards
+    local dirty_rects = {}
     for i = 0, self._dirty_area:num_rectangles() - 1 do
         local rect = self._dirty_area:get_rectangle(i)
         cr:rectangle(rect.x, rect.y, rect.width, rect.height)
+        dirty_rects[i + 1] = {
+            x = rect.x, y = rect.y, width = rect.width, height = rect.height
+        }
     end
     self._dirty_area = cairo.Region.create()
     cr:clip()
@@ -122,15 +127,18 @@ local function do_redraw(self)
     cr:save()
 
     if not capi.awesome.composite_manager_running then
-        -- This is pseudo-transparency: We draw the wallpaper in the background
-        local wallpaper = surface.load_silently(capi.root.wallpaper(), false)
-        cr.operator = cairo.Operator.SOURCE
-        if wallpaper then
-            cr:set_source_surface(wallpaper, -x, -y)
-        else
-            cr:set_source_rgb(0, 0, 0)
+        -- This is pseudo-transparency: We draw the wallpaper in the background.
+        -- The X server copies it from the root window if it can.
+        if not self.drawable:draw_wallpaper(dirty_rects) then
+            local wallpaper = surface.load_silently(capi.root.wallpaper(), false)
+            cr.operator = cairo.Operator.SOURCE
+            if wallpaper then
+                cr:set_source_surface(wallpaper, -x, -y)
+            else
+                cr:set_source_rgb(0, 0, 0)
+            end
+            cr:paint()
         end
-        cr:paint()
         cr.operator = cairo.Operator.OVER
     else
         -- This is true transparency: We draw a translucent background
@@ -161,7 +169,7 @@ local function do_redraw(self)
         self._widget_hierarchy:draw(context, cr)
     end
 
-    self.drawable:refresh()
+    self.drawable:refresh(dirty_rects)
 
     assert(cr.status == "SUCCESS", "Cairo context entered error state: " .. cr.status)
 end
@@ -412,6 +420,16 @@ function drawable.new(d, widget_context_skeleton, drawable_name)
     -- Do a full redraw if the surface changes (the new surface has no content yet)
     d:connect_signal("property::surface", ret._do_complete_repaint)
 
+    -- Redraw the part in front of a changed wallpaper
+    d.pseudo_transparent = true
+    d:connect_signal("wallpaper::changed", function(_, x, y, width, height)
+        if not ret._visible then return end
+        ret._dirty_area:union_rectangle(cairo.RectangleInt{
+            x = x, y = y, width = width, height = height
+        })
+        ret:draw()
+    end)
+
     -- Do a normal redraw when the drawable moves. This will likely do nothing
     -- in most cases, but it makes us do a complete repaint when we are moved to
     -- a different screen.
@@ -505,13 +523,6 @@ function drawable.new(d, widget_context_skeleton, drawable_name)
     })
 end
 
--- Redraw all drawables when the wallpaper changes
-capi.awesome.connect_signal("wallpaper_changed", function()
-    for d in pairs(visible_drawables) do
-        d:_do_complete_repaint()
-    end
-end)
-
 -- Give drawables a chance to react to screen changes
 local function draw_all()
     for d in pairs(visible_drawables) do
@@ -27,17 +27,21 @@
 #include "common/backtrace.h"
 #include "common/lualib.h"
 #include "common/signals.h"
+#include "common/trace.h"
 #include "common/version.h"
 #include "common/xutil.h"
 #include "dbus.h"
 #include "event.h"
 #include "ewmh.h"
 #include "globalconf.h"
+#include "loopstats.h"
 #include "objects/client.h"
 #include "objects/screen.h"
 #include "options.h"
+#include "property.h"
 #include "spawn.h"
 #include "systray.h"
+#include "winreg.h"
 #include "xkb.h"
 #include "xwindow.h"
 
@@ -52,6 +56,7 @@
 #include <xcb/bigreq.h>
 #include <xcb/randr.h>
 #include <xcb/shape.h>
+#include <xcb/shm.h>
 #include <xcb/xcb_atom.h>
 #include <xcb/xcb_aux.h>
 #include <xcb/xcb_event.h>
@@ -133,11 +138,16 @@ void awesome_atexit(bool restart) {
 
     systray_cleanup();
 
+    /* Write out a trace which is still being recorded */
+    trace_stop();
+
     /* Close Lua */
     lua_close(L);
 
     screen_cleanup();
 
+    winreg_wipe();
+
     /* X11 is a great protocol. There is a save-set so that reparenting WMs
      * don't kill clients when they shut down. However, when a focused windows
      * is saved, the focus will move to its parent with revert-to none.
@@ -189,14 +199,14 @@ static void restore_client_order(xcb_get_property_cookie_t prop_cookie) {
 }
 
 /** Scan X to find windows to manage.
+ * The requests for all windows are sent before any reply is waited on, so
+ * that the number of round trips does not grow with the number of windows.
  */
 static void scan(xcb_query_tree_cookie_t tree_c) {
-    int                                i, tree_c_len;
-    xcb_query_tree_reply_t            *tree_r;
-    xcb_window_t                      *wins = NULL;
-    xcb_get_window_attributes_reply_t *attr_r;
-    xcb_get_geometry_reply_t          *geom_r;
-    xcb_get_property_cookie_t          prop_cookie;
+    int                       i, n, tree_c_len;
+    xcb_query_tree_reply_t   *tree_r;
+    xcb_window_t             *wins = NULL;
+    xcb_get_property_cookie_t prop_cookie;
 
     tree_r = xcb_query_tree_reply(globalconf.connection, tree_c, NULL);
 
@@ -222,25 +232,46 @@ static void scan(xcb_query_tree_cookie_t tree_c) {
         geom_wins[i]  = xcb_get_geometry_unchecked(globalconf.connection, wins[i]);
     }
 
-    for (i = 0; i < tree_c_len; i++) {
-        attr_r     = xcb_get_window_attributes_reply(globalconf.connection, attr_wins[i], NULL);
-        geom_r     = xcb_get_geometry_reply(globalconf.connection, geom_wins[i], NULL);
+    /* The windows to manage, with their replies and the requests sent for them */
+    xcb_window_t                       *manage_wins = p_new(xcb_window_t, tree_c_len);
+    client_manage_cookies_t            *cookies     = p_new(client_manage_cookies_t, tree_c_len);
+    xcb_get_geometry_reply_t          **geom_r      = p_new(xcb_get_geometry_reply_t *, tree_c_len);
+    xcb_get_window_attributes_reply_t **attr_r =
+        p_new(xcb_get_window_attributes_reply_t *, tree_c_len);
+
+    for (i = n = 0; i < tree_c_len; i++) {
+        attr_r[n]  = xcb_get_window_attributes_reply(globalconf.connection, attr_wins[i], NULL);
+        geom_r[n]  = xcb_get_geometry_reply(globalconf.connection, geom_wins[i], NULL);
 
         long state = xwindow_get_state_reply(state_wins[i]);
 
-        if (!geom_r || !attr_r || attr_r->override_redirect ||
-            attr_r->map_state == XCB_MAP_STATE_UNMAPPED || state == XCB_ICCCM_WM_STATE_WITHDRAWN) {
-            p_delete(&attr_r);
-            p_delete(&geom_r);
+        if (!geom_r[n] || !attr_r[n] || attr_r[n]->override_redirect ||
+            attr_r[n]->map_state == XCB_MAP_STATE_UNMAPPED ||
+            state == XCB_ICCCM_WM_STATE_WITHDRAWN) {
+            p_delete(&attr_r[n]);
+            p_delete(&geom_r[n]);
             continue;
         }
 
-        client_manage(wins[i], geom_r, attr_r);
+        manage_wins[n] = wins[i];
+        client_manage_prefetch(wins[i], &cookies[n]);
+        n++;
+    }
+
+    for (i = 0; i < n; i++) {
+        client_manage(manage_wins[i], geom_r[i], attr_r[i], &cookies[i]);
 
-        p_delete(&attr_r);
-        p_delete(&geom_r);
+        p_delete(&attr_r[i]);
+        p_delete(&geom_r[i]);
     }
 
+    for (i = 0; i < n; i++)
+        client_manage_check(manage_wins[i], &cookies[i]);
+
+    p_delete(&cookies);
+    p_delete(&geom_r);
+    p_delete(&attr_r);
+    p_delete(&manage_wins);
     p_delete(&tree_r);
 
     restore_client_order(prop_cookie);
@@ -333,7 +364,7 @@ static void acquire_timestamp(void) {
     xutil_ungrab_server(globalconf.connection);
 
     /* Now wait for the event */
-    while ((event = xcb_wait_for_event(globalconf.connection))) {
+    while ((event = awesome_wait_for_event())) {
         /* Is it the event we are waiting for? */
         if (XCB_EVENT_RESPONSE_TYPE(event) == XCB_PROPERTY_NOTIFY) {
             xcb_property_notify_event_t *ev = (void *)event;
@@ -361,34 +392,88 @@ static xcb_generic_event_t *poll_for_event(void) {
     return xcb_poll_for_event(globalconf.connection);
 }
 
+/** The batch of events being handled by a_xcb_check(), kept between calls to
+ * avoid reallocating it */
+static struct {
+    event_array_t        events;
+    /** Index of the next event to handle */
+    int                  next;
+    /** The last motion event, handled after the others of the batch */
+    xcb_generic_event_t *mouse;
+} event_batch;
+
+/** Take the next event of the batch, which is NULL for dropped ones.
+ * \return The event, to be freed by the caller.
+ */
+static xcb_generic_event_t *event_batch_take(void) {
+    xcb_generic_event_t *event = event_batch.events.tab[event_batch.next];
+
+    event_batch.events.tab[event_batch.next++] = NULL;
+    return event;
+}
+
+/** Wait for the next event, for handlers which need to read events
+ * themselves. The rest of the batch being handled comes first, so that
+ * events are still handled in the order the X server sent them.
+ * \return The event, or NULL if the connection broke.
+ */
+xcb_generic_event_t *awesome_wait_for_event(void) {
+    xcb_generic_event_t *event;
+
+    if ((event = event_batch.mouse)) {
+        event_batch.mouse = NULL;
+        return event;
+    }
+    while (event_batch.next < event_batch.events.len)
+        if ((event = event_batch_take())) return event;
+
+    return xcb_wait_for_event(globalconf.connection);
+}
+
 static void a_xcb_check(void) {
-    xcb_generic_event_t *mouse = NULL, *event;
+    xcb_generic_event_t *event;
 
+    /* Handlers can read more events, so repeat until there are none */
     while ((event = poll_for_event())) {
-        /* We will treat mouse events later.
-         * We cannot afford to treat all mouse motion events,
-         * because that would be too much CPU intensive, so we just
-         * take the last we get after a bunch of events. */
-        if (XCB_EVENT_RESPONSE_TYPE(event) == XCB_MOTION_NOTIFY) {
-            p_delete(&mouse);
-            mouse = event;
-        } else {
-            uint8_t type = XCB_EVENT_RESPONSE_TYPE(event);
-            if (mouse && (type == XCB_ENTER_NOTIFY || type == XCB_LEAVE_NOTIFY ||
-                          type == XCB_BUTTON_PRESS || type == XCB_BUTTON_RELEASE)) {
-                /* Make sure enter/motion/leave/press/release events are handled
-                 * in the correct order */
-                event_handle(mouse);
-                p_delete(&mouse);
+        do {
+            event_array_append(&event_batch.events, event);
+        } while ((event = poll_for_event()));
+
+        event_coalesce(event_batch.events.tab, event_batch.events.len);
+        property_prefetch(event_batch.events.tab, event_batch.events.len);
+        for (event_batch.next = 0; event_batch.next < event_batch.events.len;) {
+            if (!(event = event_batch_take())) continue;
+
+            /* We will treat mouse events later.
+             * We cannot afford to treat all mouse motion events,
+             * because that would be too much CPU intensive, so we just
+             * take the last we get after a bunch of events. */
+            if (XCB_EVENT_RESPONSE_TYPE(event) == XCB_MOTION_NOTIFY) {
+                p_delete(&event_batch.mouse);
+                event_batch.mouse = event;
+            } else {
+                uint8_t type = XCB_EVENT_RESPONSE_TYPE(event);
+                if (event_batch.mouse &&
+                    (type == XCB_ENTER_NOTIFY || type == XCB_LEAVE_NOTIFY ||
+                     type == XCB_BUTTON_PRESS || type == XCB_BUTTON_RELEASE)) {
+                    /* Make sure enter/motion/leave/press/release events are handled
+                     * in the correct order */
+                    event_handle(event_batch.mouse);
+                    p_delete(&event_batch.mouse);
+                }
+                event_handle(event);
+                p_delete(&event);
             }
-            event_handle(event);
-            p_delete(&event);
         }
+        property_prefetch_finish();
+        event_batch.events.len = 0;
+        event_batch.next       = 0;
     }
 
-    if (mouse) {
-        event_handle(mouse);
-        p_delete(&mouse);
+    if ((event = event_batch.mouse)) {
+        event_batch.mouse = NULL;
+        event_handle(event);
+        p_delete(&event);
     }
 }
 
@@ -408,6 +493,7 @@ static gint a_glib_poll(GPollFD *ufds, guint nfsd, gint timeout) {
     struct timeval now, length_time;
     float          length;
     int            saved_errno;
+    int64_t        start;
     lua_State     *L = globalconf_get_lua_State();
 
     /* Do all deferred work now */
@@ -438,10 +524,13 @@ static gint a_glib_poll(GPollFD *ufds, guint nfsd, gint timeout) {
     }
 
     /* Actually do the polling, record time of wakeup and check for new xcb events */
+    start       = loop_stats_now();
     res         = g_poll(ufds, nfsd, timeout);
     saved_errno = errno;
     gettimeofday(&last_wakeup, NULL);
+    start = loop_stats_record(LOOP_PHASE_POLL, start);
     a_xcb_check();
+    loop_stats_record(LOOP_PHASE_EVENTS, start);
     errno = saved_errno;
 
     return res;
@@ -652,6 +741,7 @@ int main(int argc, char **argv) {
     xcb_prefetch_extension_data(globalconf.connection, &xcb_xinerama_id);
     xcb_prefetch_extension_data(globalconf.connection, &xcb_shape_id);
     xcb_prefetch_extension_data(globalconf.connection, &xcb_xfixes_id);
+    xcb_prefetch_extension_data(globalconf.connection, &xcb_shm_id);
 
     if (xcb_cursor_context_new(globalconf.connection, globalconf.screen, &globalconf.cursor_ctx) <
         0)
@@ -716,6 +806,10 @@ int main(int argc, char **argv) {
         xcb_discard_reply(
             globalconf.connection, xcb_xfixes_query_version(globalconf.connection, 1, 0).sequence);
 
+    /* check for MIT-SHM extension */
+    query               = xcb_get_extension_data(globalconf.connection, &xcb_shm_id);
+    globalconf.have_shm = query && query->present;
+
     event_init();
 
     /* Allocate the key symbols */
@@ -724,6 +818,8 @@ int main(int argc, char **argv) {
     /* init atom cache */
     atoms_init(globalconf.connection);
 
+    property_init();
+
     ewmh_init();
     systray_init();
 
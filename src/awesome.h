@@ -24,9 +24,11 @@
 #define AWESOME_AWESOME_H
 
 #include <stdbool.h>
+#include <xcb/xcb.h>
 
 void awesome_restart(void);
 void awesome_atexit(bool restart);
+xcb_generic_event_t *awesome_wait_for_event(void);
 
 #endif
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
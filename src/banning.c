@@ -32,14 +32,11 @@ banning_need_update(void)
      * excessive updates...  */
     globalconf.need_lazy_banning = true;
 
-    /* But if a client will be banned in our next update we unfocus it now. */
-    foreach(_c, globalconf.clients)
-    {
-        client_t *c = *_c;
-
-        if(!client_isvisible(c))
-            client_ban_unfocus(c);
-    }
+    /* But if the focused client will be banned in our next update we unfocus
+     * it now. */
+    client_t *c = globalconf.focus.client;
+    if(c && !client_isvisible(c))
+        client_ban_unfocus(c);
 }
 
 /** Check all clients if they need to rebanned
@@ -52,14 +49,17 @@ banning_refresh(void)
 
     globalconf.need_lazy_banning = false;
 
+    /* Only compute the visibility of clients whose ban state may change.
+     * Unbanning runs Lua, which may change it, so the second loop does not
+     * reuse it. */
     foreach(c, globalconf.clients)
-        if(client_isvisible(*c))
+        if((*c)->isbanned && client_isvisible(*c))
             client_unban(*c);
 
     /* Some people disliked the short flicker of background, so we first unban everything.
      * Afterwards we ban everything we don't want. This should avoid that. */
     foreach(c, globalconf.clients)
-        if(!client_isvisible(*c))
+        if(!(*c)->isbanned && !client_isvisible(*c))
             client_ban(*c);
 }
 
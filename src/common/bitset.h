@@ -0,0 +1,85 @@
+/*
+ * bitset.h - growable bit set header
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AWESOME_COMMON_BITSET_H
+#define AWESOME_COMMON_BITSET_H
+
+#include <stdint.h>
+
+#include "common/util.h"
+
+#define BITSET_WORD_BITS 64
+
+/** A set of small non-negative integers. Words past len are all zero. */
+typedef struct bitset_t {
+    uint64_t *words;
+    int       len;
+} bitset_t;
+
+static inline void bitset_wipe(bitset_t *set) {
+    p_delete(&set->words);
+    set->len = 0;
+}
+
+static inline bool bitset_test(const bitset_t *set, int bit) {
+    int word = bit / BITSET_WORD_BITS;
+    return word < set->len && (set->words[word] >> (bit % BITSET_WORD_BITS)) & 1;
+}
+
+static inline void bitset_set(bitset_t *set, int bit) {
+    int word = bit / BITSET_WORD_BITS;
+    if (word >= set->len) {
+        p_realloc(&set->words, word + 1);
+        p_clear(set->words + set->len, word + 1 - set->len);
+        set->len = word + 1;
+    }
+    set->words[word] |= UINT64_C(1) << (bit % BITSET_WORD_BITS);
+}
+
+static inline void bitset_clear(bitset_t *set, int bit) {
+    int word = bit / BITSET_WORD_BITS;
+    if (word < set->len) set->words[word] &= ~(UINT64_C(1) << (bit % BITSET_WORD_BITS));
+}
+
+/** Check if two sets have a common element.
+ * \param a A set.
+ * \param b Another set.
+ * \return True if the intersection is not empty.
+ */
+static inline bool bitset_intersects(const bitset_t *a, const bitset_t *b) {
+    int len = a->len < b->len ? a->len : b->len;
+    for (int i = 0; i < len; i++)
+        if (a->words[i] & b->words[i]) return true;
+    return false;
+}
+
+/** Find the lowest integer not in a set.
+ * \param set The set.
+ * \return The first clear bit.
+ */
+static inline int bitset_first_clear(const bitset_t *set) {
+    for (int i = 0; i < set->len; i++)
+        if (~set->words[i]) return i * BITSET_WORD_BITS + __builtin_ctzll(~set->words[i]);
+    return set->len * BITSET_WORD_BITS;
+}
+
+#endif
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
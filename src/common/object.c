@@ -25,9 +25,297 @@
  */
 #include "object.h"
 #include <moonauxlib.h>
+#include <stdint.h>
 #include "common/lualib.h"
 #include "signals.h"
 
+int luna_object_registry = LUA_NOREF;
+
+/** A class table, cached by the address of the name it was asked for with.
+ * The names come from string literals, so there are only a few of them. */
+typedef struct {
+    const char *name;
+    int         ref;
+} class_cache_entry_t;
+
+DO_ARRAY(class_cache_entry_t, class_cache, DO_NOTHING)
+
+static class_cache_array_t class_cache;
+
+/** Push a class like luaC_pushclass, remembering it for the next time.
+ * \param L The Lua VM state.
+ * \param class The name of the class, a string literal.
+ * \return True if the class exists, else nil is pushed.
+ */
+static bool luna_pushclass(lua_State *L, const char *class) {
+    foreach (entry, class_cache)
+        if (entry->name == class) {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, entry->ref);
+            return true;
+        }
+
+    if (!luaC_pushclass(L, class)) return false;
+
+    lua_pushvalue(L, -1);
+    class_cache_array_append(
+        &class_cache,
+        (class_cache_entry_t) {.name = class, .ref = luaL_ref(L, LUA_REGISTRYINDEX)});
+    return true;
+}
+
+/** A property compiled from a Properties table. */
+typedef struct {
+    /** The name, an interned Lua string held by the uservalue of the compiled
+     * properties */
+    const char   *name;
+    lua_CFunction get;
+    lua_CFunction set;
+    /** The getter or setter is not a C function, use the Properties table */
+    bool          lua;
+} object_prop_t;
+
+DO_ARRAY(object_prop_t, object_prop, DO_NOTHING)
+
+/** The properties of a class and its parents, in a perfect hash table keyed
+ * by the address of their name. Property names are short strings, which Lua
+ * interns, so the key of a lookup is the same string as the name. It lives
+ * in a userdata kept in the metatable of the instances.
+ *
+ * A key is first hashed into a bucket, whose displacement then picks the
+ * slot. The displacements are chosen when compiling so that no two names
+ * share a slot, so a lookup never probes.
+ *
+ * Properties added from Lua are not compiled until the next generation, so
+ * names which are not found are still looked up in the Properties table. */
+typedef struct {
+    /** object_props_generation when this was compiled */
+    unsigned       generation;
+    uint32_t       buckets_mask;
+    uint32_t       slots_mask;
+    uint32_t      *displacements;
+    object_prop_t *slots;
+} object_props_t;
+
+/** Key of the compiled properties in the metatable of instances */
+static const char object_props_key = 0;
+
+/** Changes whenever properties are added to some class, so that the compiled
+ * properties of every class get compiled again */
+static unsigned object_props_generation = 1;
+
+static inline uint32_t object_props_hash(const char *name, uint32_t seed) {
+    uint64_t h = ((uintptr_t)name ^ seed) * UINT64_C(0x9e3779b97f4a7c15);
+    h ^= h >> 29;
+    h *= UINT64_C(0xbf58476d1ce4e5b9);
+    return h ^ (h >> 32);
+}
+
+static inline uint32_t object_props_bucket(const object_props_t *props, const char *name) {
+    return object_props_hash(name, 0) & props->buckets_mask;
+}
+
+static inline uint32_t
+object_props_slot(const object_props_t *props, const char *name, uint32_t displacement) {
+    return object_props_hash(name, displacement * 0x85ebca6bu) & props->slots_mask;
+}
+
+/** Find a property.
+ * \param props The compiled properties.
+ * \param name The name, as returned by lua_tostring.
+ * \return The property, or NULL.
+ */
+static inline const object_prop_t *
+object_props_lookup(const object_props_t *props, const char *name) {
+    const object_prop_t *prop =
+        &props->slots[object_props_slot(
+            props, name, props->displacements[object_props_bucket(props, name)])];
+
+    return prop->name == name ? prop : NULL;
+}
+
+/** Collect the properties of a Properties table and the ones it inherits,
+ * and pop the Properties table.
+ * \param L The Lua VM state.
+ * \param props The array to add the properties to.
+ * \param names The absolute index of a table to keep their names in.
+ */
+static void object_props_collect(lua_State *L, object_prop_array_t *props, int names) {
+    /* Properties of parents are reached through the __index of the
+     * metatable of the Properties table, see object_inherited */
+    while (lua_type(L, -1) == LUA_TTABLE) {
+        lua_pushnil(L);
+        while (lua_next(L, -2)) {
+            if (lua_type(L, -2) != LUA_TSTRING) {
+                lua_pop(L, 1);
+                continue;
+            }
+
+            const char   *name = lua_tostring(L, -2);
+            object_prop_t prop = {.name = name};
+            bool          seen = false;
+
+            /* A property of the class hides the one of its parent */
+            foreach (p, *props)
+                if (p->name == name) seen = true;
+
+            if (!seen) {
+                if (lua_type(L, -1) != LUA_TTABLE) prop.lua = true;
+                else {
+                    if (lua_getfield(L, -1, "get") == LUA_TFUNCTION) {
+                        prop.get = lua_tocfunction(L, -1);
+                        prop.lua |= !prop.get;
+                    }
+                    if (lua_getfield(L, -2, "set") == LUA_TFUNCTION) {
+                        prop.set = lua_tocfunction(L, -1);
+                        prop.lua |= !prop.set;
+                    }
+                    lua_pop(L, 2);
+                }
+                object_prop_array_append(props, prop);
+                lua_pushvalue(L, -2);
+                lua_rawseti(L, names, props->len);  // keep the name
+            }
+            lua_pop(L, 1);  // pop value
+        }
+
+        if (!lua_getmetatable(L, -1)) break;
+        lua_getfield(L, -1, "__index");
+        lua_remove(L, -2);  // remove metatable
+        lua_remove(L, -2);  // remove Properties table
+    }
+    lua_pop(L, 1);
+}
+
+/** Choose the displacement of each bucket so that every property gets a slot
+ * of its own.
+ * \param props The compiled properties, with empty slots.
+ * \param names The properties.
+ * \return False if that did not work out with this number of slots.
+ */
+static bool object_props_place(object_props_t *props, object_prop_array_t *names) {
+    uint32_t  nbuckets = props->buckets_mask + 1;
+    int      *order    = p_new(int, nbuckets);
+    int      *sizes    = p_new(int, nbuckets);
+    uint32_t *wanted   = p_new(uint32_t, names->len);
+    bool      ok       = true;
+
+    foreach (prop, *names)
+        sizes[object_props_bucket(props, prop->name)]++;
+
+    /* Place the biggest buckets first, while most slots are free */
+    for (uint32_t i = 0; i < nbuckets; i++) {
+        uint32_t j = i;
+        for (; j > 0 && sizes[order[j - 1]] < sizes[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    for (uint32_t i = 0; ok && i < nbuckets && sizes[order[i]]; i++) {
+        uint32_t bucket = order[i];
+        uint32_t d;
+
+        for (d = 1; d < 1u << 16; d++) {
+            int n = 0;
+
+            foreach (prop, *names) {
+                if (object_props_bucket(props, prop->name) != bucket) continue;
+
+                uint32_t slot = object_props_slot(props, prop->name, d);
+                bool     free = !props->slots[slot].name;
+
+                for (int k = 0; free && k < n; k++)
+                    free = wanted[k] != slot;
+                if (!free) break;
+                wanted[n++] = slot;
+            }
+
+            if (n == sizes[bucket]) break;
+        }
+
+        if (d == 1u << 16) {
+            ok = false;
+            break;
+        }
+
+        props->displacements[bucket] = d;
+        foreach (prop, *names)
+            if (object_props_bucket(props, prop->name) == bucket)
+                props->slots[object_props_slot(props, prop->name, d)] = *prop;
+    }
+
+    p_delete(&order);
+    p_delete(&sizes);
+    p_delete(&wanted);
+    return ok;
+}
+
+/** Compile the properties of the class of the instances with the metatable at
+ * the given index, and keep them in that metatable.
+ * \param L The Lua VM state.
+ * \param mt The absolute index of the metatable.
+ * \return The compiled properties.
+ */
+static object_props_t *object_props_compile(lua_State *L, int mt) {
+    object_prop_array_t names;
+    object_props_t     *props;
+    uint32_t            nbuckets = 1, nslots = 8;
+
+    object_prop_array_init(&names);
+    lua_newtable(L);  // names of the properties
+    if (lua_getfield(L, mt, "__class") == LUA_TTABLE) {
+        lua_getfield(L, -1, "Properties");
+        object_props_collect(L, &names, lua_absindex(L, -3));
+    }
+    lua_pop(L, 1);  // pop class
+
+    while (nbuckets * 2 < (uint32_t)names.len)
+        nbuckets *= 2;
+    while (nslots < (uint32_t)names.len * 2)
+        nslots *= 2;
+
+    for (;; nslots *= 2) {
+        size_t size = sizeof(object_props_t) + nslots * sizeof(object_prop_t) +
+                      nbuckets * sizeof(uint32_t);
+
+        props = lua_newuserdatauv(L, size, 1);
+        p_clear(props, 1);
+        props->generation    = object_props_generation;
+        props->buckets_mask  = nbuckets - 1;
+        props->slots_mask    = nslots - 1;
+        props->slots         = (object_prop_t *)(props + 1);
+        props->displacements = (uint32_t *)(props->slots + nslots);
+        p_clear(props->slots, nslots);
+        p_clear(props->displacements, nbuckets);
+
+        if (object_props_place(props, &names)) break;
+        lua_pop(L, 1);
+    }
+
+    lua_insert(L, -2);
+    lua_setiuservalue(L, -2, 1);  // keep the names alive
+    lua_rawsetp(L, mt, &object_props_key);
+    object_prop_array_wipe(&names);
+    return props;
+}
+
+/** Get the compiled properties of the class of an object.
+ * \param L The Lua VM state.
+ * \param idx The index of the object.
+ * \return The compiled properties, or NULL if the object has no metatable.
+ */
+static object_props_t *object_props_get(lua_State *L, int idx) {
+    object_props_t *props = NULL;
+
+    if (!lua_getmetatable(L, idx)) return NULL;
+    if (lua_rawgetp(L, -1, &object_props_key) == LUA_TUSERDATA) props = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    if (!props || props->generation != object_props_generation)
+        props = object_props_compile(L, lua_absindex(L, -1));
+    lua_pop(L, 1);  // pop metatable
+
+    return props;
+}
+
 // NOTE: may expand with custom newindex later
 static int make_proptable(lua_State *L) {
     lua_newtable(L);
@@ -48,6 +336,20 @@ static int object_index(lua_State *L) {
             lua_getfield(L, -1, s);
             return 1;
         }
+
+        object_props_t *props = object_props_get(L, 1);
+        if (props) {
+            const object_prop_t *prop = object_props_lookup(props, s);
+
+            if (prop && !prop->lua && prop->get) {
+                lua_settop(L, 1);  // leave self for the getter
+                return prop->get(L);
+            }
+            if (prop && !prop->lua) {
+                luaC_deferindex(L);
+                return 1;
+            }
+        }
     }
 
     luaL_getmetafield(L, 1, "__class");
@@ -66,6 +368,24 @@ static int object_index(lua_State *L) {
 }
 
 static int object_newindex(lua_State *L) {
+    if (lua_type(L, 2) == LUA_TSTRING) {
+        object_props_t *props = object_props_get(L, 1);
+        if (props) {
+            const object_prop_t *prop = object_props_lookup(props, lua_tostring(L, 2));
+
+            if (prop && !prop->lua && prop->set) {
+                lua_settop(L, 3);
+                lua_remove(L, 2);  // leave self and value for the setter
+                prop->set(L);
+                return 0;
+            }
+            if (prop && !prop->lua) {
+                luaC_defernewindex(L);
+                return 0;
+            }
+        }
+    }
+
     luaL_getmetafield(L, 1, "__class");
     if (lua_getfield(L, -1, "Properties") == LUA_TTABLE) {
         lua_pushvalue(L, 2);                      // push key
@@ -82,6 +402,7 @@ static int object_newindex(lua_State *L) {
 }
 
 static int object_inherited(lua_State *L) {
+    object_props_generation++;
     luaC_construct(L, 0, "SignalStore");
     lua_setfield(L, 2, "Signals");
     lua_getfield(L, 2, "Properties");  // Properties field of inherited class
@@ -112,6 +433,8 @@ void luaC_register_object(lua_State *L) {
     lua_pushcfunction(L, make_proptable);
     lua_setfield(L, -2, "Properties");
     lua_newtable(L);
+    lua_pushvalue(L, -1);
+    luna_object_registry = luaL_ref(L, LUA_REGISTRYINDEX);
     lua_setfield(L, LUA_REGISTRYINDEX, LUNA_OBJECT_REGISTRY_KEY);
 }
 
@@ -144,16 +467,33 @@ void luna_object_disconnect_signal(lua_State *L, int idx, const char *name) {
     lua_pop(L, 1);
 }
 
-void luna_object_emit_signal(lua_State *L, int idx, const char *name, int nargs) {
+void luna_object_emit_signal_id(lua_State *L, int idx, luna_signal_id_t id, int nargs) {
     if (lua_getfield(L, idx, "Signals") == LUA_TUSERDATA) {
-        lua_insert(L, -nargs);
-        luna_signal_store_emit(L, -nargs - 1, name, nargs);
-    }
+        lua_insert(L, -nargs - 1);  // insert store before args
+        luna_signal_store_emit_id(L, -nargs - 1, id, nargs);
+        lua_pop(L, 1);             // pop store
+    } else lua_pop(L, nargs + 1);  // pop nil and args
+}
+
+void luna_object_emit_signal(lua_State *L, int idx, const char *name, int nargs) {
+    luna_object_emit_signal_id(L, idx, luna_signal_intern(name), nargs);
+}
+
+void luna_object_drop_coalesced_signals(lua_State *L, int idx) {
+    if (lua_getfield(L, idx, "Signals") == LUA_TUSERDATA) luna_signal_store_drop_coalesced(L, -1);
+    lua_pop(L, 1);
+}
+
+bool luna_object_has_listeners(lua_State *L, int idx, luna_signal_id_t id) {
+    bool ret = false;
+    if (lua_getfield(L, idx, "Signals") == LUA_TUSERDATA)
+        ret = luna_signal_store_has_listeners(L, -1, id);
     lua_pop(L, 1);
+    return ret;
 }
 
 void luna_class_connect_signal(lua_State *L, const char *class, const char *name) {
-    if (luaC_pushclass(L, class)) {
+    if (luna_pushclass(L, class)) {
         lua_insert(L, -2);
         luna_object_connect_signal(L, -2, name);
     }
@@ -161,21 +501,32 @@ void luna_class_connect_signal(lua_State *L, const char *class, const char *name
 }
 
 void luna_class_disconnect_signal(lua_State *L, const char *class, const char *name) {
-    if (luaC_pushclass(L, class)) {
+    if (luna_pushclass(L, class)) {
         lua_insert(L, -2);
         luna_object_disconnect_signal(L, -2, name);
     }
     lua_pop(L, 1);
 }
 
-void luna_class_emit_signal(lua_State *L, const char *class, const char *name, int nargs) {
-    if (luaC_pushclass(L, class)) {
+void luna_class_emit_signal_id(lua_State *L, const char *class, luna_signal_id_t id, int nargs) {
+    if (luna_pushclass(L, class)) {
         lua_insert(L, -nargs - 1);
-        luna_object_emit_signal(L, -nargs - 1, name, nargs);
+        luna_object_emit_signal_id(L, -nargs - 1, id, nargs);
     }
     lua_pop(L, 1);
 }
 
+bool luna_class_has_listeners(lua_State *L, const char *class, luna_signal_id_t id) {
+    bool ret = false;
+    if (luna_pushclass(L, class)) ret = luna_object_has_listeners(L, -1, id);
+    lua_pop(L, 1);
+    return ret;
+}
+
+void luna_class_emit_signal(lua_State *L, const char *class, const char *name, int nargs) {
+    luna_class_emit_signal_id(L, class, luna_signal_intern(name), nargs);
+}
+
 void luna_class_add_property(
     lua_State    *L,
     int           idx,
@@ -184,6 +535,7 @@ void luna_class_add_property(
     lua_CFunction set) {
     if (lua_getfield(L, idx, "Properties") != LUA_TTABLE)
         luaL_error(L, "Invalid or missing property table");
+    object_props_generation++;
     lua_newtable(L);
     lua_pushcfunction(L, get);
     lua_setfield(L, -2, "get");
@@ -195,6 +547,7 @@ void luna_class_add_property(
 
 void luna_class_setprops(lua_State *L, int idx, const luna_Prop props[], int nprops) {
     if (!props->name || !luaC_isclass(L, idx)) return;
+    object_props_generation++;
     lua_pushstring(L, "Properties");
     lua_createtable(L, 0, nprops);  // properties table
     do {
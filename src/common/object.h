@@ -31,27 +31,30 @@
 
 #include <luaclasslib.h>
 #include "refcount.h"
+#include "signals.h"
 
 void luaC_register_object(lua_State *);
 
+/** Registry slot of the object registry, it is also kept under
+ * LUNA_OBJECT_REGISTRY_KEY. Event handlers push objects all the time, so
+ * this saves hashing the key every time. */
+extern int luna_object_registry;
+
 static inline void *luna_object_ref(lua_State *L, int idx) {
-    lua_pushliteral(L, LUNA_OBJECT_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
-    void *p = (void *)_luna_object_incref(L, idx > 0 ? idx : idx - 1);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luna_object_registry);
+    void *p = (void *)_luna_object_incref_header(L, idx > 0 ? idx : idx - 1);
     lua_pop(L, 1);
     return p;
 }
 
 static inline void luna_object_unref(lua_State *L, const void *ptr) {
-    lua_pushliteral(L, LUNA_OBJECT_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
-    _luna_object_decref(L, ptr);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luna_object_registry);
+    _luna_object_decref_header(L, ptr);
     lua_pop(L, 1);
 }
 
 static inline void luna_object_push(lua_State *L, const void *ptr) {
-    lua_pushliteral(L, LUNA_OBJECT_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luna_object_registry);
     lua_rawgetp(L, -1, ptr);
     lua_remove(L, -2);
 }
@@ -81,12 +84,25 @@ void luna_object_disconnect_signal(lua_State *L, int idx, const char *name);
 
 void luna_object_emit_signal(lua_State *L, int idx, const char *name, int nargs);
 
+void luna_object_emit_signal_id(lua_State *L, int idx, luna_signal_id_t id, int nargs);
+
+bool luna_object_has_listeners(lua_State *L, int idx, luna_signal_id_t id);
+
+/** Forget the coalesced signals of an object which became invalid. */
+void luna_object_drop_coalesced_signals(lua_State *L, int idx);
+
+/* Classes are looked up once and cached by the address of their name, so the
+ * names passed to these must be string literals. */
 void luna_class_connect_signal(lua_State *L, const char *class, const char *name);
 
 void luna_class_disconnect_signal(lua_State *, const char *class, const char *);
 
 void luna_class_emit_signal(lua_State *L, const char *class, const char *name, int nargs);
 
+void luna_class_emit_signal_id(lua_State *L, const char *class, luna_signal_id_t id, int nargs);
+
+bool luna_class_has_listeners(lua_State *L, const char *class, luna_signal_id_t id);
+
 void luna_class_add_property(
     lua_State    *L,
     int           idx,
@@ -0,0 +1,290 @@
+/*
+ * pixel.c - pixel format conversion
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Conversions of icon and image data to the formats cairo wants, with SIMD
+ * versions picked at runtime depending on what the CPU supports.
+ *
+ * Premultiplying is done as c * (a / 255.0) truncated, in double precision,
+ * like it always was. An exact integer division by 255 would round up instead
+ * for a few values (e.g. 85 * 147 / 255 is 49, but 85 * (147 / 255.0) is
+ * slightly below), and icons should not change depending on the CPU. */
+
+#include "common/pixel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIXEL_X86
+#include <immintrin.h>
+#endif
+
+typedef struct {
+    void (*premultiply_argb)(uint32_t *, const uint32_t *, size_t);
+    void (*premultiply_rgba)(uint32_t *, const uint8_t *, size_t);
+    void (*rgb_to_rgb24)(uint32_t *, const uint8_t *, size_t);
+} pixel_kernels_t;
+
+static inline uint32_t pixel_premultiply(uint8_t a, uint8_t r, uint8_t g, uint8_t b) {
+    double alpha = a / 255.0;
+
+    r            = r * alpha;
+    g            = g * alpha;
+    b            = b * alpha;
+    return ((uint32_t)a << 24) | (r << 16) | (g << 8) | b;
+}
+
+static void pixel_premultiply_argb_scalar(uint32_t *dst, const uint32_t *src, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        dst[i] = pixel_premultiply(src[i] >> 24, src[i] >> 16, src[i] >> 8, src[i]);
+}
+
+static void pixel_premultiply_rgba_scalar(uint32_t *dst, const uint8_t *src, size_t n) {
+    for (size_t i = 0; i < n; i++, src += 4)
+        dst[i] = pixel_premultiply(src[3], src[0], src[1], src[2]);
+}
+
+static void pixel_rgb_to_rgb24_scalar(uint32_t *dst, const uint8_t *src, size_t n) {
+    for (size_t i = 0; i < n; i++, src += 3)
+        dst[i] = (src[0] << 16) | (src[1] << 8) | src[2];
+}
+
+#ifdef PIXEL_X86
+
+/* Each channel is widened to double, multiplied with a / 255.0 and truncated
+ * back, which is what the scalar version does one value at a time. */
+
+__attribute__((target("sse2"))) static inline __m128i
+pixel_mul_alpha_sse2(__m128i c, __m128d alpha_lo, __m128d alpha_hi) {
+    __m128i lo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(c), alpha_lo));
+    __m128i hi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(c, 8)), alpha_hi));
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+/** Premultiply 4 pixels, given as one channel per 32 bit lane */
+__attribute__((target("sse2"))) static inline __m128i
+pixel_premultiply_sse2(__m128i a, __m128i r, __m128i g, __m128i b) {
+    __m128d scale    = _mm_set1_pd(255.0);
+    __m128d alpha_lo = _mm_div_pd(_mm_cvtepi32_pd(a), scale);
+    __m128d alpha_hi = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(a, 8)), scale);
+
+    r                = pixel_mul_alpha_sse2(r, alpha_lo, alpha_hi);
+    g                = pixel_mul_alpha_sse2(g, alpha_lo, alpha_hi);
+    b                = pixel_mul_alpha_sse2(b, alpha_lo, alpha_hi);
+    return _mm_or_si128(
+        _mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(r, 16)),
+        _mm_or_si128(_mm_slli_epi32(g, 8), b));
+}
+
+__attribute__((target("sse2"))) static void
+pixel_premultiply_argb_sse2(uint32_t *dst, const uint32_t *src, size_t n) {
+    __m128i mask = _mm_set1_epi32(0xff);
+    size_t  i    = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i res = pixel_premultiply_sse2(
+            _mm_srli_epi32(px, 24), _mm_and_si128(_mm_srli_epi32(px, 16), mask),
+            _mm_and_si128(_mm_srli_epi32(px, 8), mask), _mm_and_si128(px, mask));
+        _mm_storeu_si128((__m128i *)(dst + i), res);
+    }
+
+    pixel_premultiply_argb_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse2"))) static void
+pixel_premultiply_rgba_sse2(uint32_t *dst, const uint8_t *src, size_t n) {
+    __m128i mask = _mm_set1_epi32(0xff);
+    size_t  i    = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + i * 4));
+        __m128i res = pixel_premultiply_sse2(
+            _mm_srli_epi32(px, 24), _mm_and_si128(px, mask),
+            _mm_and_si128(_mm_srli_epi32(px, 8), mask),
+            _mm_and_si128(_mm_srli_epi32(px, 16), mask));
+        _mm_storeu_si128((__m128i *)(dst + i), res);
+    }
+
+    pixel_premultiply_rgba_scalar(dst + i, src + i * 4, n - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+pixel_mul_alpha_avx2(__m256i c, __m256d alpha_lo, __m256d alpha_hi) {
+    __m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(c));
+    __m256d hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(c, 1));
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm256_cvttpd_epi32(_mm256_mul_pd(lo, alpha_lo))),
+        _mm256_cvttpd_epi32(_mm256_mul_pd(hi, alpha_hi)), 1);
+}
+
+/** Premultiply 8 pixels, given as one channel per 32 bit lane */
+__attribute__((target("avx2"))) static inline __m256i
+pixel_premultiply_avx2(__m256i a, __m256i r, __m256i g, __m256i b) {
+    __m256d scale    = _mm256_set1_pd(255.0);
+    __m256d alpha_lo = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)), scale);
+    __m256d alpha_hi = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)), scale);
+
+    r                = pixel_mul_alpha_avx2(r, alpha_lo, alpha_hi);
+    g                = pixel_mul_alpha_avx2(g, alpha_lo, alpha_hi);
+    b                = pixel_mul_alpha_avx2(b, alpha_lo, alpha_hi);
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_slli_epi32(a, 24), _mm256_slli_epi32(r, 16)),
+        _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+}
+
+__attribute__((target("avx2"))) static void
+pixel_premultiply_argb_avx2(uint32_t *dst, const uint32_t *src, size_t n) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    size_t  i    = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i res = pixel_premultiply_avx2(
+            _mm256_srli_epi32(px, 24), _mm256_and_si256(_mm256_srli_epi32(px, 16), mask),
+            _mm256_and_si256(_mm256_srli_epi32(px, 8), mask), _mm256_and_si256(px, mask));
+        _mm256_storeu_si256((__m256i *)(dst + i), res);
+    }
+
+    pixel_premultiply_argb_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+pixel_premultiply_rgba_avx2(uint32_t *dst, const uint8_t *src, size_t n) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    size_t  i    = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+        __m256i res = pixel_premultiply_avx2(
+            _mm256_srli_epi32(px, 24), _mm256_and_si256(px, mask),
+            _mm256_and_si256(_mm256_srli_epi32(px, 8), mask),
+            _mm256_and_si256(_mm256_srli_epi32(px, 16), mask));
+        _mm256_storeu_si256((__m256i *)(dst + i), res);
+    }
+
+    pixel_premultiply_rgba_scalar(dst + i, src + i * 4, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+pixel_rgb_to_rgb24_avx2(uint32_t *dst, const uint8_t *src, size_t n) {
+    /* Spread 4 packed RGB pixels out to 0RGB, in memory order BGR0 */
+    __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    size_t  i       = 0;
+
+    /* Every load reads 16 bytes of which only 12 are used, stop before
+     * reading past the end */
+    for (; i + 6 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + i * 3));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(px, shuffle));
+    }
+
+    pixel_rgb_to_rgb24_scalar(dst + i, src + i * 3, n - i);
+}
+
+#endif
+
+static const char *const pixel_impl_names[PIXEL_IMPL_COUNT] = {
+    [PIXEL_IMPL_SCALAR] = "scalar",
+    [PIXEL_IMPL_SSE2]   = "sse2",
+    [PIXEL_IMPL_AVX2]   = "avx2",
+};
+
+static const pixel_kernels_t pixel_impls[PIXEL_IMPL_COUNT] = {
+    [PIXEL_IMPL_SCALAR] =
+        {pixel_premultiply_argb_scalar, pixel_premultiply_rgba_scalar, pixel_rgb_to_rgb24_scalar},
+#ifdef PIXEL_X86
+    /* SSE2 has no byte shuffle, RGB stays scalar */
+    [PIXEL_IMPL_SSE2] =
+        {pixel_premultiply_argb_sse2, pixel_premultiply_rgba_sse2, pixel_rgb_to_rgb24_scalar},
+    [PIXEL_IMPL_AVX2] =
+        {pixel_premultiply_argb_avx2, pixel_premultiply_rgba_avx2, pixel_rgb_to_rgb24_avx2},
+#endif
+};
+
+static const pixel_kernels_t *pixel_kernels = NULL;
+
+static bool pixel_impl_supported(pixel_impl_t impl) {
+    switch (impl) {
+        case PIXEL_IMPL_SCALAR: return true;
+#ifdef PIXEL_X86
+        case PIXEL_IMPL_SSE2: __builtin_cpu_init(); return __builtin_cpu_supports("sse2");
+        case PIXEL_IMPL_AVX2: __builtin_cpu_init(); return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+/** Pick the fastest implementation the CPU supports */
+static void pixel_init(void) {
+    for (int impl = PIXEL_IMPL_COUNT - 1; impl >= 0; impl--)
+        if (pixel_impl_supported(impl)) {
+            pixel_kernels = &pixel_impls[impl];
+            return;
+        }
+}
+
+/** Premultiply ARGB pixels.
+ * \param dst Where to store the premultiplied ARGB pixels.
+ * \param src The ARGB pixels.
+ * \param n The number of pixels.
+ */
+void pixel_premultiply_argb(uint32_t *dst, const uint32_t *src, size_t n) {
+    if (!pixel_kernels) pixel_init();
+    pixel_kernels->premultiply_argb(dst, src, n);
+}
+
+/** Convert RGBA bytes, as used by GdkPixbuf, to premultiplied ARGB pixels.
+ * \param dst Where to store the premultiplied ARGB pixels.
+ * \param src The RGBA bytes, 4 per pixel.
+ * \param n The number of pixels.
+ */
+void pixel_premultiply_rgba(uint32_t *dst, const uint8_t *src, size_t n) {
+    if (!pixel_kernels) pixel_init();
+    pixel_kernels->premultiply_rgba(dst, src, n);
+}
+
+/** Convert RGB bytes, as used by GdkPixbuf, to RGB24 pixels.
+ * \param dst Where to store the RGB24 pixels.
+ * \param src The RGB bytes, 3 per pixel.
+ * \param n The number of pixels.
+ */
+void pixel_rgb_to_rgb24(uint32_t *dst, const uint8_t *src, size_t n) {
+    if (!pixel_kernels) pixel_init();
+    pixel_kernels->rgb_to_rgb24(dst, src, n);
+}
+
+/** Force an implementation, for testing and benchmarking.
+ * \param impl The implementation.
+ * \return False if the CPU does not support it.
+ */
+bool pixel_set_impl(pixel_impl_t impl) {
+    if (impl >= PIXEL_IMPL_COUNT || !pixel_impl_supported(impl)) return false;
+    pixel_kernels = &pixel_impls[impl];
+    return true;
+}
+
+/** Get the name of an implementation.
+ * \param impl The implementation.
+ * \return The name.
+ */
+const char *pixel_impl_name(pixel_impl_t impl) {
+    return pixel_impl_names[impl];
+}
+
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
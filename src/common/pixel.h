@@ -0,0 +1,43 @@
+/*
+ * pixel.h - pixel format conversion header
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AWESOME_COMMON_PIXEL_H
+#define AWESOME_COMMON_PIXEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    PIXEL_IMPL_SCALAR,
+    PIXEL_IMPL_SSE2,
+    PIXEL_IMPL_AVX2,
+    PIXEL_IMPL_COUNT
+} pixel_impl_t;
+
+void        pixel_premultiply_argb(uint32_t *, const uint32_t *, size_t);
+void        pixel_premultiply_rgba(uint32_t *, const uint8_t *, size_t);
+void        pixel_rgb_to_rgb24(uint32_t *, const uint8_t *, size_t);
+bool        pixel_set_impl(pixel_impl_t);
+const char *pixel_impl_name(pixel_impl_t);
+
+#endif
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
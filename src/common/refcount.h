@@ -1,6 +1,13 @@
+#ifndef LUNA_COMMON_REFCOUNT_H
+#define LUNA_COMMON_REFCOUNT_H
+
 #include <lua.h>
 #include "backtrace.h"
 
+/* References are kept in a table holding the referenced values, with the
+ * counts in its metatable. Objects referenced in the object registry count
+ * their references themselves instead, see LUNA_OBJECT_HEADER. */
+
 static inline const void *_luna_object_incref(lua_State *L, int idx) {
     const void *ptr = NULL;
 
@@ -49,3 +56,51 @@ static inline void _luna_object_decref(lua_State *L, const void *ptr) {
         lua_rawsetp(L, -2, ptr);
     }
 }
+
+/** Objects which can be referenced in the object registry start with this.
+ * The registry only holds them while their count is not 0, so taking another
+ * reference is just an increment. */
+#define LUNA_OBJECT_HEADER                     \
+    /** Number of references held by C code */ \
+    int refcount;
+
+typedef struct {
+    LUNA_OBJECT_HEADER
+} luna_object_t;
+
+static inline const void *_luna_object_incref_header(lua_State *L, int idx) {
+    luna_object_t *obj = lua_touserdata(L, idx);
+
+    if (obj && obj->refcount++ == 0) {
+        lua_pushvalue(L, idx);    // push object
+        lua_rawsetp(L, -2, obj);  // ref it in the table
+    }
+    lua_remove(L, idx);  // remove object
+    return obj;
+}
+
+static inline void _luna_object_decref_header(lua_State *L, const void *ptr) {
+    luna_object_t *obj = (luna_object_t *)ptr;
+
+    if (!obj) return;
+
+    // did something goof? Don't touch the object if it is not held anymore.
+    if (lua_rawgetp(L, -1, obj) == LUA_TNIL || obj->refcount <= 0) {
+        buffer_t buf;
+        backtrace_get(&buf);
+        warn("BUG: Reference not found: %p\n%s", ptr, buf.s);
+
+        /* Pop what was found */
+        lua_pop(L, 1);
+        return;
+    }
+    lua_pop(L, 1);  // pop object
+
+    // remove ref from table if necessary
+    if (!--obj->refcount) {
+        lua_pushnil(L);
+        lua_rawsetp(L, -2, obj);
+    }
+}
+
+#endif
@@ -25,9 +25,13 @@
  */
 
 #include "signals.h"
+#include <stdint.h>
 #include <string.h>
 #include "lualib.h"
 #include "refcount.h"
+#include "trace.h"
+
+int luna_global_signals = LUA_NOREF;
 
 static inline int _cptr_cmp(const void *a, const void *b) {
     const void **x = (const void **)a, **y = (const void **)b;
@@ -39,6 +43,8 @@ DO_BARRAY(const void *, cptr, DO_NOTHING, _cptr_cmp)
 typedef struct {
     unsigned long id;
     cptr_array_t  slots;
+    /** The name the signal was connected with, for tracing */
+    char         *name;
 } signal_t;
 
 static inline int _signal_cmp(const void *a, const void *b) {
@@ -48,39 +54,115 @@ static inline int _signal_cmp(const void *a, const void *b) {
 
 static inline void _signal_wipe(signal_t *sig) {
     cptr_array_wipe(&sig->slots);
+    p_delete(&sig->name);
 }
 
 DO_BARRAY(signal_t, signal, _signal_wipe, _signal_cmp)
 
-static inline signal_t *signal_array_getbyid(signal_array_t *arr, unsigned long id) {
+/** How many slots of a store a function is. The slot table holds the
+ * function while this is not 0. */
+typedef struct {
+    const void *func;
+    int         count;
+} slot_ref_t;
+
+static inline int _slot_ref_cmp(const void *a, const void *b) {
+    const slot_ref_t *x = a, *y = b;
+    return x->func > y->func ? 1 : (x->func < y->func ? -1 : 0);
+}
+
+DO_BARRAY(slot_ref_t, slot_ref, DO_NOTHING, _slot_ref_cmp)
+
+/** A SignalStore. Bit (id % 64) of listeners is set when some signal hashing
+ * to that bucket has slots, so most emits of unconnected signals stop there. */
+typedef struct {
+    signal_array_t   signals;
+    uint64_t         listeners;
+    slot_ref_array_t slot_refs;
+} signal_store_t;
+
+#define SIGNAL_BIT(id) (UINT64_C(1) << ((id) % 64))
+
+static void signal_store_update_listeners(signal_store_t *store) {
+    store->listeners = 0;
+    foreach (sig, store->signals)
+        store->listeners |= SIGNAL_BIT(sig->id);
+}
+
+static inline signal_t *signal_store_getbyid(signal_store_t *store, luna_signal_id_t id) {
+    if (!(store->listeners & SIGNAL_BIT(id))) return NULL;
     signal_t sig = {.id = id};
-    return signal_array_lookup(arr, &sig);
+    return signal_array_lookup(&store->signals, &sig);
+}
+
+/** Reference the function below the slot table on top of the stack as a slot
+ * of a store, and remove it from the stack.
+ * \param L The Lua VM state.
+ * \param store The store.
+ * \return The function's pointer.
+ */
+static const void *signal_store_ref(lua_State *L, signal_store_t *store) {
+    slot_ref_t  ref   = {.func = lua_topointer(L, -2), .count = 1};
+    slot_ref_t *found = slot_ref_array_lookup(&store->slot_refs, &ref);
+
+    if (found) found->count++;
+    else {
+        slot_ref_array_insert(&store->slot_refs, ref);
+        lua_pushvalue(L, -2);          // push func
+        lua_rawsetp(L, -2, ref.func);  // put it in the slot table
+    }
+    lua_remove(L, -2);  // remove func
+    return ref.func;
+}
+
+/** Drop a reference to a slot of a store, the slot table being on top of the
+ * stack.
+ * \param L The Lua VM state.
+ * \param store The store.
+ * \param func The function's pointer.
+ */
+static void signal_store_unref(lua_State *L, signal_store_t *store, const void *func) {
+    slot_ref_t  ref   = {.func = func};
+    slot_ref_t *found = slot_ref_array_lookup(&store->slot_refs, &ref);
+
+    if (!found) {
+        buffer_t buf;
+        backtrace_get(&buf);
+        warn("BUG: Reference not found: %p\n%s", func, buf.s);
+        return;
+    }
+
+    if (--found->count) return;
+
+    slot_ref_array_remove(&store->slot_refs, found);
+    lua_pushnil(L);
+    lua_rawsetp(L, -2, func);  // remove func from the slot table
 }
 
 void luna_signal_store_connect(lua_State *L, int idx, const char *name) {
     luaA_checkfunction(L, -1);
-    signal_array_t *arr      = luaC_checkuclass(L, idx, "SignalStore");
-    unsigned long   id       = a_strhash((unsigned const char *)name);
-    signal_t       *sigfound = signal_array_getbyid(arr, id);
+    signal_store_t  *store    = luaC_checkuclass(L, idx, "SignalStore");
+    luna_signal_id_t id       = luna_signal_intern_static(name);
+    signal_t        *sigfound = signal_store_getbyid(store, id);
     lua_getiuservalue(L, idx, 2);                  // get slot table
-    const void *ref = _luna_object_incref(L, -2);  // ref func
+    const void *ref = signal_store_ref(L, store);  // ref func
 
     if (sigfound) {
         cptr_array_insert(&sigfound->slots, ref);
     } else {
-        signal_t sig = {.id = id};
+        signal_t sig = {.id = id, .name = a_strdup(name)};
         cptr_array_init(&sig.slots);
         cptr_array_insert(&sig.slots, ref);
-        signal_array_insert(arr, sig);
+        signal_array_insert(&store->signals, sig);
+        store->listeners |= SIGNAL_BIT(id);
     }
 
     lua_pop(L, 2);  // pop slot table and func
 }
 
 void luna_signal_store_disconnect(lua_State *L, int idx, const char *name) {
-    signal_array_t *arr      = luaC_checkuclass(L, idx, "SignalStore");
-    unsigned long   id       = a_strhash((unsigned const char *)name);
-    signal_t       *sigfound = signal_array_getbyid(arr, id);
+    signal_store_t *store    = luaC_checkuclass(L, idx, "SignalStore");
+    signal_t       *sigfound = signal_store_getbyid(store, luna_signal_intern(name));
     const void     *ref = lua_islightuserdata(L, -1) ? lua_touserdata(L, -1) : lua_topointer(L, -1);
 
     if (sigfound) {
@@ -89,33 +171,250 @@ void luna_signal_store_disconnect(lua_State *L, int idx, const char *name) {
             cptr_array_remove(&sigfound->slots, elem);
         }
         if (sigfound->slots.len == 0) {
-            cptr_array_wipe(&sigfound->slots);
-            signal_array_remove(arr, sigfound);
+            _signal_wipe(sigfound);
+            signal_array_remove(&store->signals, sigfound);
+            signal_store_update_listeners(store);
         }
-        lua_getiuservalue(L, idx, 2);  // get slot table
-        _luna_object_decref(L, ref);   // unref func
-        lua_pop(L, 1);                 // pop slot table
+        lua_getiuservalue(L, idx, 2);       // get slot table
+        signal_store_unref(L, store, ref);  // unref func
+        lua_pop(L, 1);                      // pop slot table
     }
 
     lua_pop(L, 1);  // pop func
 }
 
-void luna_signal_store_emit(lua_State *L, int idx, const char *name, int nargs) {
-    signal_array_t *arr      = luaC_checkuclass(L, idx, "SignalStore");
-    unsigned long   id       = a_strhash((unsigned const char *)name);
-    signal_t       *sigfound = signal_array_getbyid(arr, id);
+static void signal_store_emit(lua_State *L, int idx, luna_signal_id_t id, int nargs) {
+    signal_store_t *store        = luaC_checkuclass(L, idx, "SignalStore");
+    signal_t       *sigfound     = signal_store_getbyid(store, id);
+    int64_t         traced_start = 0;
+    char            traced[TRACE_NAME_LEN];
+    int             traced_slots = 0;
+
+    /* Slots may connect or disconnect signals, don't look at sigfound after
+     * calling them */
+    if (trace_buffer && sigfound) {
+        traced_start = trace_now();
+        traced_slots = sigfound->slots.len;
+        a_strcpy(traced, sizeof(traced), sigfound->name);
+    }
+
     if (sigfound) {
-        int start = lua_gettop(L) - nargs;
+        int top    = lua_gettop(L);
+        int start  = top - nargs;
+        int nslots = sigfound->slots.len;
+        luaL_checkstack(L, nslots + nargs + 2, "too many signal slots");
         lua_getiuservalue(L, idx, 2);  // get slot table from store
-        foreach (slot, sigfound->slots) {
-            lua_rawgetp(L, -1, *slot);  // get func from slot table
-            for (int i = start; i < start + nargs; i++)
-                lua_pushvalue(L, i);    // push copies of args
+        /* Push all funcs before calling any, since slots may disconnect
+         * others */
+        for (int i = 0; i < nslots; i++)
+            lua_rawgetp(L, top + 1, sigfound->slots.tab[i]);  // get func from slot table
+        lua_remove(L, top + 1);                               // remove slot table
+        for (int i = 1; i <= nslots; i++) {
+            lua_pushvalue(L, top + i);  // push func
+            for (int j = start; j < start + nargs; j++)
+                lua_pushvalue(L, j);    // push copies of args
             lua_pcall(L, nargs, 0, 0);  // call the func
         }
-        lua_pop(L, 1);  // pop slot table
+        lua_settop(L, top);  // pop funcs
     }
     lua_pop(L, nargs);  // pop args
+
+    /* Emits of unconnected signals are too cheap to be worth tracing */
+    if (traced_start && trace_buffer)
+        trace_span("signal", traced, traced_start, trace_now(), "slots", traced_slots);
+}
+
+static int _signal_id_cmp(const void *a, const void *b) {
+    const luna_signal_id_t *x = a, *y = b;
+    return *x > *y ? 1 : (*x < *y ? -1 : 0);
+}
+
+DO_BARRAY(luna_signal_id_t, signal_id, DO_NOTHING, _signal_id_cmp)
+
+/** Ids of the signals named ":property.*" */
+static signal_id_array_t property_signals;
+
+luna_signal_id_t luna_signal_intern_static(const char *name) {
+    luna_signal_id_t id = luna_signal_intern(name);
+
+    if (A_STREQ_N(name, ":property.", sizeof(":property.") - 1)
+        && !signal_id_array_lookup(&property_signals, &id))
+        signal_id_array_insert(&property_signals, id);
+    return id;
+}
+
+/** A property signal waiting for luna_signal_emit_coalesced(). The store and
+ * the arguments are kept in the values table, at 2k-1 and 2k for the k-th. */
+typedef struct {
+    const signal_store_t *store;
+    luna_signal_id_t      id;
+    int                   nargs;
+} coalesced_signal_t;
+
+DO_ARRAY(coalesced_signal_t, coalesced_signal, DO_NOTHING)
+
+static struct {
+    bool                     enabled;
+    coalesced_signal_array_t pending;
+    /** Open addressing index of pending by store and id, holding k for the
+     * k-th signal and 0 for empty slots */
+    int                     *index;
+    int                      index_size;
+    /** Registry slot of the values table */
+    int                      values;
+} coalesced = {.values = LUA_NOREF};
+
+unsigned long luna_signal_coalesced_count = 0;
+
+static int *coalesced_slot(const signal_store_t *store, luna_signal_id_t id) {
+    uint64_t h   = ((uintptr_t)store ^ (id * UINT64_C(0x9E3779B97F4A7C15)));
+    int      pos = (int)((h * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (coalesced.index_size - 1);
+
+    for (;; pos = (pos + 1) & (coalesced.index_size - 1)) {
+        int k = coalesced.index[pos];
+
+        if (!k) return &coalesced.index[pos];
+        /* Dropped signals have no store and never match */
+        if (coalesced.pending.tab[k - 1].store == store && coalesced.pending.tab[k - 1].id == id)
+            return &coalesced.index[pos];
+    }
+}
+
+/** Make room in the index for one more pending signal. */
+static void coalesced_reserve(void) {
+    if ((coalesced.pending.len + 1) * 2 <= coalesced.index_size) return;
+
+    coalesced.index_size = MAX(coalesced.index_size * 2, 64);
+    p_realloc(&coalesced.index, coalesced.index_size);
+    p_clear(coalesced.index, coalesced.index_size);
+    for (int k = 1; k <= coalesced.pending.len; k++) {
+        coalesced_signal_t *sig = &coalesced.pending.tab[k - 1];
+        *coalesced_slot(sig->store, sig->id) = k;
+    }
+}
+
+/** Record a property signal of the store at \p idx for later, with the
+ * arguments on top of the stack, and remove the arguments from the stack.
+ * Later emits of the same signal of the store are dropped, so its slots get
+ * the arguments of the first one, ie. the old values. */
+static void signal_store_coalesce(lua_State *L, int idx, luna_signal_id_t id, int nargs) {
+    signal_store_t *store = luaC_checkuclass(L, idx, "SignalStore");
+    int            *slot;
+
+    /* Slots connected later would not have been called either */
+    if (!signal_store_getbyid(store, id)) {
+        lua_pop(L, nargs);
+        return;
+    }
+
+    coalesced_reserve();
+    if (*(slot = coalesced_slot(store, id))) {
+        luna_signal_coalesced_count++;
+        lua_pop(L, nargs);
+        return;
+    }
+
+    idx = lua_absindex(L, idx);
+    coalesced_signal_array_append(
+        &coalesced.pending,
+        (coalesced_signal_t){.store = store, .id = id, .nargs = nargs});
+    *slot = coalesced.pending.len;
+
+    if (coalesced.values == LUA_NOREF) {
+        lua_newtable(L);
+        coalesced.values = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+    lua_rawgeti(L, LUA_REGISTRYINDEX, coalesced.values);
+    lua_pushvalue(L, idx);
+    lua_rawseti(L, -2, 2 * *slot - 1);  // values[2k-1] = store
+    if (nargs) {
+        lua_insert(L, -nargs - 1);  // insert values table before args
+        lua_createtable(L, nargs, 0);
+        lua_insert(L, -nargs - 1);  // insert args table before args
+        for (int i = nargs; i >= 1; i--)
+            lua_rawseti(L, -i - 1, i);
+        lua_rawseti(L, -2, 2 * *slot);  // values[2k] = args
+    }
+    lua_pop(L, 1);  // pop values table
+}
+
+void luna_signal_store_emit_id(lua_State *L, int idx, luna_signal_id_t id, int nargs) {
+    if (unlikely(coalesced.enabled) && signal_id_array_lookup(&property_signals, &id))
+        signal_store_coalesce(L, idx, id, nargs);
+    else signal_store_emit(L, idx, id, nargs);
+}
+
+void luna_signal_store_emit(lua_State *L, int idx, const char *name, int nargs) {
+    luna_signal_store_emit_id(L, idx, luna_signal_intern(name), nargs);
+}
+
+bool luna_signal_has_coalesced(void) {
+    return coalesced.pending.len > 0;
+}
+
+void luna_signal_store_drop_coalesced(lua_State *L, int idx) {
+    signal_store_t *store = luaC_checkuclass(L, idx, "SignalStore");
+
+    if (!coalesced.pending.len) return;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, coalesced.values);
+    for (int k = 1; k <= coalesced.pending.len; k++) {
+        if (coalesced.pending.tab[k - 1].store != store) continue;
+        coalesced.pending.tab[k - 1].store = NULL;
+        lua_pushnil(L);
+        lua_rawseti(L, -2, 2 * k - 1);  // values[2k-1] = nil
+        lua_pushnil(L);
+        lua_rawseti(L, -2, 2 * k);  // values[2k] = nil
+    }
+    lua_pop(L, 1);  // pop values table
+}
+
+bool luna_signal_emit_coalesced(lua_State *L) {
+    bool emitted = false;
+
+    for (int round = 0; round < LUNA_SIGNAL_COALESCED_ROUNDS && coalesced.pending.len; round++) {
+        /* Slots may change properties again, those are recorded afresh */
+        coalesced_signal_array_t batch = coalesced.pending;
+        coalesced_signal_array_init(&coalesced.pending);
+        p_clear(coalesced.index, coalesced.index_size);
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, coalesced.values);
+        lua_newtable(L);
+        lua_rawseti(L, LUA_REGISTRYINDEX, coalesced.values);
+
+        for (int k = 1; k <= batch.len; k++) {
+            int nargs = batch.tab[k - 1].nargs;
+
+            if (!batch.tab[k - 1].store) continue;
+            emitted = true;
+
+            lua_rawgeti(L, -1, 2 * k - 1);  // get store
+            if (nargs) {
+                lua_rawgeti(L, -2, 2 * k);  // get args table
+                for (int i = 1; i <= nargs; i++)
+                    lua_rawgeti(L, -i, i);
+                lua_remove(L, -nargs - 1);  // remove args table
+            }
+            signal_store_emit(L, -nargs - 1, batch.tab[k - 1].id, nargs);
+            lua_pop(L, 1);  // pop store
+        }
+        lua_pop(L, 1);  // pop values table
+
+        coalesced_signal_array_wipe(&batch);
+    }
+
+    return emitted;
+}
+
+void luna_signal_set_coalescing(lua_State *L, bool enable) {
+    /* Don't keep anything recorded waiting for a phase which does not care */
+    if (!enable) luna_signal_emit_coalesced(L);
+    coalesced.enabled = enable;
+}
+
+bool luna_signal_store_has_listeners(lua_State *L, int idx, luna_signal_id_t id) {
+    signal_store_t *store = luaC_checkuclass(L, idx, "SignalStore");
+    return signal_store_getbyid(store, id) != NULL;
 }
 
 static int signal_interface_init(lua_State *L) {
@@ -146,7 +445,8 @@ static int signal_interface_disconnect(lua_State *L) {
 static int signal_interface_call(lua_State *L) {
     lua_getfield(L, 1, "_store");
     lua_getfield(L, 1, "_name");
-    luna_signal_store_emit(L, -2, lua_tostring(L, -1), lua_gettop(L) - 3);
+    /* Signals emitted from Lua are never coalesced */
+    signal_store_emit(L, -2, luna_signal_intern(lua_tostring(L, -1)), lua_gettop(L) - 3);
     return 0;
 }
 
@@ -167,19 +467,20 @@ static luaC_Class signal_interface_class = {
     .methods   = signal_interface_methods};
 
 static void signal_store_alloc(lua_State *L) {
-    signal_array_t *arr = lua_newuserdatauv(L, sizeof(signal_array_t), 2);
+    signal_store_t *store = lua_newuserdatauv(L, sizeof(signal_store_t), 2);
     lua_newtable(L);  // slot table
-    lua_newtable(L);  // slot metatable (for refcount)
-    lua_setmetatable(L, -2);
     lua_setiuservalue(L, -2, 2);
-    signal_array_init(arr);
+    signal_array_init(&store->signals);
+    slot_ref_array_init(&store->slot_refs);
+    store->listeners = 0;
 }
 
 static void signal_store_gc(lua_State *L, void *p) {
-    signal_array_t *arr = (signal_array_t *)p;
-    foreach (sig, *arr)
+    signal_store_t *store = (signal_store_t *)p;
+    foreach (sig, store->signals)
         cptr_array_wipe(&sig->slots);
-    signal_array_wipe(arr);
+    signal_array_wipe(&store->signals);
+    slot_ref_array_wipe(&store->slot_refs);
 }
 
 static int signal_store_index(lua_State *L) {
@@ -209,9 +510,9 @@ static int connection_connected(lua_State *L) {
     int ret = 0;
     if (lua_getfield(L, 1, "_store") == LUA_TUSERDATA) {
         lua_getfield(L, 1, "_name");
-        signal_array_t *arr = lua_touserdata(L, -2);
+        signal_store_t *store = lua_touserdata(L, -2);
         signal_t       *sigfound =
-            signal_array_getbyid(arr, a_strhash((const unsigned char *)lua_tostring(L, -1)));
+            signal_store_getbyid(store, luna_signal_intern(lua_tostring(L, -1)));
         if (sigfound) {
             lua_getfield(L, 1, "_value");
             const void *ref = lua_touserdata(L, -1);
@@ -272,5 +573,7 @@ void luaC_register_signal_store(lua_State *L) {
     lua_pop(L, 2);
 
     luaC_construct(L, 0, "SignalStore");
+    lua_pushvalue(L, -1);
+    luna_global_signals = luaL_ref(L, LUA_REGISTRYINDEX);
     lua_setfield(L, LUA_REGISTRYINDEX, LUNA_GLOBAL_SIGNALS);
 }
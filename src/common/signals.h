@@ -32,32 +32,98 @@
 #include "array.h"
 #define LUNA_GLOBAL_SIGNALS "lunaria.signals.global"
 
+/** Signals are looked up by the hash of their name. C code emitting the same
+ * signal over and over can resolve it once and use the *_emit_id functions. */
+typedef unsigned long luna_signal_id_t;
+
+static inline luna_signal_id_t luna_signal_intern(const char *name) {
+    return a_strhash((const unsigned char *)name);
+}
+
+/** Intern the signal named by prefix followed by suffix, without building the
+ * name. \p prefix is the interned id of the first part. */
+static inline luna_signal_id_t
+luna_signal_intern_suffix(luna_signal_id_t prefix, const char *suffix) {
+    luna_signal_id_t id = prefix;
+    int              c;
+
+    while ((c = (unsigned char)*suffix++))
+        id = ((id << 5) + id) + c; /* same as a_strhash */
+
+    return id;
+}
+
+/** Intern a signal name, remembering the ":property.*" ones so that they can
+ * be coalesced. Used when connecting and by LUNA_SIGNAL, so that emitting
+ * by name only hashes it. */
+luna_signal_id_t luna_signal_intern_static(const char *name);
+
+/** Intern a constant signal name the first time the call site runs. */
+#define LUNA_SIGNAL(name)                                                          \
+    ({                                                                             \
+        static luna_signal_id_t __signal_id = 0;                                   \
+        if (unlikely(!__signal_id)) __signal_id = luna_signal_intern_static(name); \
+        __signal_id;                                                               \
+    })
+
+/** Registry slot of the global SignalStore, it is also kept under
+ * LUNA_GLOBAL_SIGNALS. */
+extern int luna_global_signals;
+
 void luna_signal_store_connect(lua_State *, int, const char *);
 void luna_signal_store_disconnect(lua_State *, int, const char *);
 void luna_signal_store_emit(lua_State *, int, const char *, int);
+void luna_signal_store_emit_id(lua_State *, int, luna_signal_id_t, int);
+bool luna_signal_store_has_listeners(lua_State *, int, luna_signal_id_t);
+
+/** While coalescing is enabled, property signals emitted from C are recorded
+ * instead, once per store and signal, with the arguments of the first emit.
+ * luna_signal_emit_coalesced() emits what was recorded and returns whether
+ * there was anything. Disabling coalescing emits what was recorded.
+ * luna_signal_store_drop_coalesced() forgets what was recorded for a store,
+ * for objects which become invalid. */
+void luna_signal_set_coalescing(lua_State *, bool);
+bool luna_signal_has_coalesced(void);
+bool luna_signal_emit_coalesced(lua_State *);
+void luna_signal_store_drop_coalesced(lua_State *, int);
+
+/** Upper bound on the rounds of emitting coalesced signals in a row, in case
+ * slots keep changing properties back and forth */
+#define LUNA_SIGNAL_COALESCED_ROUNDS 16
+
+/** Number of property signals dropped because they were already recorded */
+extern unsigned long luna_signal_coalesced_count;
 
 static inline void luna_connect_global_signal(lua_State *L, const char *name) {
-    lua_pushstring(L, LUNA_GLOBAL_SIGNALS);
-    lua_rawget(L, LUA_REGISTRYINDEX);  // get global SignalStore
-    lua_insert(L, -2);                 // insert before func
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luna_global_signals);  // get global SignalStore
+    lua_insert(L, -2);                                       // insert before func
     luna_signal_store_connect(L, -2, name);
     lua_pop(L, 1);  // pop SignalStore
 }
 
 static inline void luna_disconnect_global_signal(lua_State *L, const char *name) {
-    lua_pushstring(L, LUNA_GLOBAL_SIGNALS);
-    lua_rawget(L, LUA_REGISTRYINDEX);  // get global SignalStore
-    lua_insert(L, -2);                 // insert before func
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luna_global_signals);  // get global SignalStore
+    lua_insert(L, -2);                                       // insert before func
     luna_signal_store_disconnect(L, -2, name);
     lua_pop(L, 1);  // pop SignalStore
 }
 
-static inline void luna_emit_global_signal(lua_State *L, const char *name, int nargs) {
-    lua_pushstring(L, LUNA_GLOBAL_SIGNALS);
-    lua_rawget(L, LUA_REGISTRYINDEX);  // get global SignalStore
-    lua_insert(L, -nargs - 1);         // insert before args
-    luna_signal_store_emit(L, -nargs - 1, name, nargs);
+static inline void luna_emit_global_signal_id(lua_State *L, luna_signal_id_t id, int nargs) {
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luna_global_signals);  // get global SignalStore
+    lua_insert(L, -nargs - 1);                               // insert before args
+    luna_signal_store_emit_id(L, -nargs - 1, id, nargs);
+    lua_pop(L, 1);  // pop SignalStore
+}
+
+static inline bool luna_global_has_listeners(lua_State *L, luna_signal_id_t id) {
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luna_global_signals);  // get global SignalStore
+    bool ret = luna_signal_store_has_listeners(L, -1, id);
     lua_pop(L, 1);  // pop SignalStore
+    return ret;
+}
+
+static inline void luna_emit_global_signal(lua_State *L, const char *name, int nargs) {
+    luna_emit_global_signal_id(L, luna_signal_intern(name), nargs);
 }
 
 void luaC_register_signal_store(lua_State *);
@@ -0,0 +1,166 @@
+/*
+ * trace.c - event tracing
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* While tracing, timed spans (X event dispatch, signal emission, main loop
+ * phases) go into a fixed size ring buffer, the oldest ones being overwritten
+ * once it is full. Stopping the trace writes the buffer out in the Chrome
+ * trace event format, which chrome://tracing and Perfetto can open. */
+
+#include "common/trace.h"
+#include "common/util.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Number of spans kept, a power of two */
+#define TRACE_CAPACITY (1 << 16)
+
+typedef struct {
+    int64_t     start, end;
+    /** Static strings */
+    const char *category, *arg_name;
+    uint64_t    arg;
+    char        name[TRACE_NAME_LEN];
+} trace_span_t;
+
+struct trace_buffer_t {
+    /** Where to write the trace when it stops */
+    char         *path;
+    /** When the trace started */
+    int64_t       origin;
+    trace_span_t *spans;
+    /** Number of spans recorded, only the last TRACE_CAPACITY are kept */
+    uint64_t      count;
+};
+
+trace_buffer_t *trace_buffer = NULL;
+
+/** Get the current time of the monotonic clock.
+ * \return The time in nanoseconds.
+ */
+int64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** Record a span. Only call this while tracing.
+ * \param category The category of the span, a static string.
+ * \param name The name of the span, copied.
+ * \param start When the span started, as returned by trace_now().
+ * \param end When the span ended.
+ * \param arg_name The name of the argument, a static string or NULL.
+ * \param arg The argument.
+ */
+void trace_span(
+    const char *category, const char *name, int64_t start, int64_t end, const char *arg_name,
+    uint64_t arg) {
+    trace_span_t *span = &trace_buffer->spans[trace_buffer->count++ & (TRACE_CAPACITY - 1)];
+
+    span->start        = start;
+    span->end          = end;
+    span->category     = category;
+    span->arg_name     = arg_name;
+    span->arg          = arg;
+    a_strcpy(span->name, sizeof(span->name), name);
+}
+
+/** Start tracing.
+ * \param path Where to write the trace when it stops.
+ * \return False if tracing was already on.
+ */
+bool trace_start(const char *path) {
+    if (trace_buffer) return false;
+
+    trace_buffer         = p_new(trace_buffer_t, 1);
+    trace_buffer->path   = a_strdup(path);
+    trace_buffer->spans  = p_new(trace_span_t, TRACE_CAPACITY);
+    trace_buffer->origin = trace_now();
+
+    return true;
+}
+
+static void trace_write_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20) fprintf(f, "\\u%04x", *s);
+        else fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static bool trace_write(trace_buffer_t *trace) {
+    FILE *f = fopen(trace->path, "w");
+    if (!f) return false;
+
+    uint64_t first = trace->count > TRACE_CAPACITY ? trace->count - TRACE_CAPACITY : 0;
+    int      pid   = getpid();
+
+    fputs("{\"traceEvents\":[", f);
+    for (uint64_t i = first; i < trace->count; i++) {
+        trace_span_t *span = &trace->spans[i & (TRACE_CAPACITY - 1)];
+
+        if (i != first) fputs(",\n", f);
+        fputs("{\"name\":", f);
+        trace_write_string(f, span->name);
+        fprintf(
+            f, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+            span->category, (span->start - trace->origin) / 1e3, (span->end - span->start) / 1e3,
+            pid, pid);
+        if (span->arg_name) fprintf(f, ",\"args\":{\"%s\":%" PRIu64 "}", span->arg_name, span->arg);
+        fputc('}', f);
+    }
+    fprintf(f, "],\"otherData\":{\"dropped_spans\":%" PRIu64 "}}\n", first);
+
+    int err = ferror(f) ? EIO : 0;
+    if (fclose(f) != 0 && !err) err = errno;
+    errno = err;
+    return !err;
+}
+
+/** Stop tracing and write out the trace.
+ * \return False if tracing was off or the trace could not be written, with
+ * errno set in the latter case.
+ */
+bool trace_stop(void) {
+    trace_buffer_t *trace = trace_buffer;
+
+    if (!trace) return false;
+
+    /* Stop recording before writing, nothing in here should show up */
+    trace_buffer = NULL;
+
+    bool ok      = trace_write(trace);
+    int  err     = errno;
+
+    p_delete(&trace->spans);
+    p_delete(&trace->path);
+    p_delete(&trace);
+
+    errno = err;
+    return ok;
+}
+
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
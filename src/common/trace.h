@@ -0,0 +1,43 @@
+/*
+ * trace.h - event tracing header
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AWESOME_COMMON_TRACE_H
+#define AWESOME_COMMON_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Span names longer than this are truncated */
+#define TRACE_NAME_LEN 48
+
+typedef struct trace_buffer_t trace_buffer_t;
+
+/** The buffer spans are recorded into, NULL while tracing is off. Call sites
+ * check it before doing any work so that tracing costs nothing when off. */
+extern trace_buffer_t *trace_buffer;
+
+int64_t trace_now(void);
+void    trace_span(const char *, const char *, int64_t, int64_t, const char *, uint64_t);
+bool    trace_start(const char *);
+bool    trace_stop(void);
+
+#endif
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -20,6 +20,7 @@
  */
 
 #include "draw.h"
+#include "common/pixel.h"
 #include "config.h"
 #include "globalconf.h"
 
@@ -45,20 +46,12 @@ static inline void free_data(void *data) {
  * \return Number of items pushed on the lua stack.
  */
 cairo_surface_t *draw_surface_from_data(int width, int height, uint32_t *data) {
-    unsigned long int len = width * height;
-    unsigned long int i;
+    unsigned long int len    = width * height;
     uint32_t         *buffer = p_new(uint32_t, len);
     cairo_surface_t  *surface;
 
     /* Cairo wants premultiplied alpha, meh :( */
-    for (i = 0; i < len; i++) {
-        uint8_t a     = (data[i] >> 24) & 0xff;
-        double  alpha = a / 255.0;
-        uint8_t r     = ((data[i] >> 16) & 0xff) * alpha;
-        uint8_t g     = ((data[i] >> 8) & 0xff) * alpha;
-        uint8_t b     = ((data[i] >> 0) & 0xff) * alpha;
-        buffer[i]     = (a << 24) | (r << 16) | (g << 8) | b;
-    }
+    pixel_premultiply_argb(buffer, data, len);
 
     surface = cairo_image_surface_create_for_data(
         (unsigned char *)buffer, CAIRO_FORMAT_ARGB32, width, height, width * 4);
@@ -91,26 +84,9 @@ cairo_surface_t *draw_surface_from_pixbuf(GdkPixbuf *buf) {
     cairo_pixels = cairo_image_surface_get_data(surface);
 
     for (int y = 0; y < height; y++) {
-        guchar   *row   = pixels;
         uint32_t *cairo = (uint32_t *)cairo_pixels;
-        for (int x = 0; x < width; x++) {
-            if (channels == 3) {
-                uint8_t r = *row++;
-                uint8_t g = *row++;
-                uint8_t b = *row++;
-                *cairo++  = (r << 16) | (g << 8) | b;
-            } else {
-                uint8_t r     = *row++;
-                uint8_t g     = *row++;
-                uint8_t b     = *row++;
-                uint8_t a     = *row++;
-                double  alpha = a / 255.0;
-                r             = r * alpha;
-                g             = g * alpha;
-                b             = b * alpha;
-                *cairo++      = (a << 24) | (r << 16) | (g << 8) | b;
-            }
-        }
+        if (channels == 3) pixel_rgb_to_rgb24(cairo, pixels, width);
+        else pixel_premultiply_rgba(cairo, pixels, width);
         pixels += pix_stride;
         cairo_pixels += cairo_stride;
     }
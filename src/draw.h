@@ -49,6 +49,8 @@ struct area_t {
 #define AREA_EQUAL(a, b) \
     ((a).x == (b).x && (a).y == (b).y && (a).width == (b).width && (a).height == (b).height)
 
+DO_ARRAY(area_t, area, DO_NOTHING)
+
 static inline void cairo_surface_array_destroy_surface(cairo_surface_t **s) {
     cairo_surface_destroy(*s);
 }
@@ -24,6 +24,7 @@
 #include "awesome.h"
 #include "common/atoms.h"
 #include "common/signals.h"
+#include "common/trace.h"
 #include "common/xutil.h"
 #include "ewmh.h"
 #include "keygrabber.h"
@@ -51,34 +52,34 @@
 #include <xcb/xfixes.h>
 #include <xcb/xkb.h>
 
-#define DO_EVENT_HOOK_CALLBACK(type, xcbtype, xcbeventprefix, arraytype, match)              \
-    static void event_##xcbtype##_callback(                                                  \
-        xcb_##xcbtype##_press_event_t *ev, arraytype *arr, lua_State *L, int oud, int nargs, \
-        void *data) {                                                                        \
-        int abs_oud       = oud < 0 ? ((lua_gettop(L) + 1) + oud) : oud;                     \
-        int item_matching = 0;                                                               \
-        foreach (item, *arr)                                                                 \
-            if (match(ev, *item, data)) {                                                    \
-                if (oud) luna_object_push_item(L, abs_oud, *item);                           \
-                else luna_object_push(L, *item);                                             \
-                item_matching++;                                                             \
-            }                                                                                \
-        for (; item_matching > 0; item_matching--) {                                         \
-            switch (ev->response_type) {                                                     \
-                case xcbeventprefix##_PRESS:                                                 \
-                    for (int i = 0; i < nargs; i++)                                          \
-                        lua_pushvalue(L, -nargs - item_matching);                            \
-                    luna_object_emit_signal(L, -nargs - 1, "press", nargs);                  \
-                    break;                                                                   \
-                case xcbeventprefix##_RELEASE:                                               \
-                    for (int i = 0; i < nargs; i++)                                          \
-                        lua_pushvalue(L, -nargs - item_matching);                            \
-                    luna_object_emit_signal(L, -nargs - 1, "release", nargs);                \
-                    break;                                                                   \
-            }                                                                                \
-            lua_pop(L, 1);                                                                   \
-        }                                                                                    \
-        lua_pop(L, nargs);                                                                   \
+#define DO_EVENT_HOOK_CALLBACK(type, xcbtype, xcbeventprefix, arraytype, match)               \
+    static void event_##xcbtype##_callback(                                                   \
+        xcb_##xcbtype##_press_event_t *ev, arraytype *arr, lua_State *L, int oud, int nargs,  \
+        void *data) {                                                                         \
+        int abs_oud       = oud < 0 ? ((lua_gettop(L) + 1) + oud) : oud;                      \
+        int item_matching = 0;                                                                \
+        foreach (item, *arr)                                                                  \
+            if (match(ev, *item, data)) {                                                     \
+                if (oud) luna_object_push_item(L, abs_oud, *item);                            \
+                else luna_object_push(L, *item);                                              \
+                item_matching++;                                                              \
+            }                                                                                 \
+        for (; item_matching > 0; item_matching--) {                                          \
+            switch (ev->response_type) {                                                      \
+                case xcbeventprefix##_PRESS:                                                  \
+                    for (int i = 0; i < nargs; i++)                                           \
+                        lua_pushvalue(L, -nargs - item_matching);                             \
+                    luna_object_emit_signal_id(L, -nargs - 1, LUNA_SIGNAL("press"), nargs);   \
+                    break;                                                                    \
+                case xcbeventprefix##_RELEASE:                                                \
+                    for (int i = 0; i < nargs; i++)                                           \
+                        lua_pushvalue(L, -nargs - item_matching);                             \
+                    luna_object_emit_signal_id(L, -nargs - 1, LUNA_SIGNAL("release"), nargs); \
+                    break;                                                                    \
+            }                                                                                 \
+            lua_pop(L, 1);                                                                    \
+        }                                                                                     \
+        lua_pop(L, nargs);                                                                    \
     }
 
 static bool event_key_match(xcb_key_press_event_t *ev, keyb_t *k, void *data) {
@@ -127,13 +128,13 @@ static bool event_handle_mousegrabber(int x, int y, uint16_t mask) {
  * \param ev The event to handle.
  */
 static void event_emit_button(lua_State *L, xcb_button_press_event_t *ev) {
-    const char *name;
+    luna_signal_id_t id;
     switch (XCB_EVENT_RESPONSE_TYPE(ev)) {
         case XCB_BUTTON_PRESS:
-            name = ":button.press";
+            id = LUNA_SIGNAL(":button.press");
             break;
         case XCB_BUTTON_RELEASE:
-            name = ":button.release";
+            id = LUNA_SIGNAL(":button.release");
             break;
         default:
             fatal("Invalid event type");
@@ -145,7 +146,7 @@ static void event_emit_button(lua_State *L, xcb_button_press_event_t *ev) {
     lua_pushinteger(L, ev->detail);
     luaA_pushmodifiers(L, ev->state);
     /* And emit the signal */
-    luna_object_emit_signal(L, -5, name, 4);
+    luna_object_emit_signal_id(L, -5, id, 4);
 }
 
 /** The button press event handler.
@@ -336,34 +337,37 @@ static void event_handle_configurerequest(xcb_configure_request_event_t *ev) {
         }
 
         c->got_configure_request = true;
+        client_queue_geometry_refresh(c);
 
         /* Request the changes to be applied */
         luna_object_push(L, c);
-        lua_pushstring(L, "ewmh"); /* context */
-        lua_newtable(L);           /* props */
-
-        /* area, it needs to be directly in the `hints` table to comply with
-           the "protocol"
-         */
-        lua_pushstring(L, "x");
-        lua_pushinteger(L, geometry.x);
-        lua_rawset(L, -3);
-
-        lua_pushstring(L, "y");
-        lua_pushinteger(L, geometry.y);
-        lua_rawset(L, -3);
-
-        lua_pushstring(L, "width");
-        lua_pushinteger(L, geometry.width);
-        lua_rawset(L, -3);
-
-        lua_pushstring(L, "height");
-        lua_pushinteger(L, geometry.height);
-        lua_rawset(L, -3);
-
-        luna_object_emit_signal(L, -3, ":request.geometry", 2);
+        if (luna_object_has_listeners(L, -1, LUNA_SIGNAL(":request.geometry"))) {
+            lua_pushstring(L, "ewmh"); /* context */
+            lua_newtable(L);           /* props */
+
+            /* area, it needs to be directly in the `hints` table to comply with
+               the "protocol"
+             */
+            lua_pushstring(L, "x");
+            lua_pushinteger(L, geometry.x);
+            lua_rawset(L, -3);
+
+            lua_pushstring(L, "y");
+            lua_pushinteger(L, geometry.y);
+            lua_rawset(L, -3);
+
+            lua_pushstring(L, "width");
+            lua_pushinteger(L, geometry.width);
+            lua_rawset(L, -3);
+
+            lua_pushstring(L, "height");
+            lua_pushinteger(L, geometry.height);
+            lua_rawset(L, -3);
+
+            luna_object_emit_signal_id(L, -3, LUNA_SIGNAL(":request.geometry"), 2);
+        }
         lua_pop(L, 1);
-    } else if (xembed_getbywin(&globalconf.embedded, ev->window)) {
+    } else if (systray_getbywin(ev->window)) {
         /* Ignore this so that systray icons cannot resize themselves.
          * We decide their size!
          * However, Xembed says that we act like a WM to the embedded window and
@@ -416,12 +420,7 @@ static void event_handle_destroynotify(xcb_destroy_notify_event_t *ev) {
     client_t *c;
 
     if ((c = client_getbywin(ev->window))) client_unmanage(c, CLIENT_UNMANAGE_DESTROYED);
-    else
-        for (int i = 0; i < globalconf.embedded.len; i++)
-            if (globalconf.embedded.tab[i].win == ev->window) {
-                xembed_window_array_take(&globalconf.embedded, i);
-                luaA_systray_invalidate();
-            }
+    else systray_remove(ev->window);
 }
 
 /** Record that the given drawable contains the pointer.
@@ -441,7 +440,7 @@ void event_drawable_under_mouse(lua_State *L, int ud) {
     if (globalconf.drawable_under_mouse != NULL) {
         /* Emit leave on previous drawable */
         luna_object_push(L, globalconf.drawable_under_mouse);
-        luna_object_emit_signal(L, -1, ":mouse.leave", 0);
+        luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":mouse.leave"), 0);
         lua_pop(L, 1);
 
         /* Unref the previous drawable */
@@ -453,7 +452,7 @@ void event_drawable_under_mouse(lua_State *L, int ud) {
         globalconf.drawable_under_mouse = d;
 
         /* Emit enter */
-        luna_object_emit_signal(L, ud, ":mouse.enter", 0);
+        luna_object_emit_signal_id(L, ud, LUNA_SIGNAL(":mouse.enter"), 0);
     }
 }
 
@@ -473,7 +472,7 @@ static void event_handle_motionnotify(xcb_motion_notify_event_t *ev) {
         luna_object_push(L, c);
         lua_pushinteger(L, ev->event_x);
         lua_pushinteger(L, ev->event_y);
-        luna_object_emit_signal(L, -3, ":mouse.move", 2);
+        luna_object_emit_signal_id(L, -3, LUNA_SIGNAL(":mouse.move"), 2);
 
         /* now check if a titlebar was "hit" */
         int         x = ev->event_x, y = ev->event_y;
@@ -483,7 +482,7 @@ static void event_handle_motionnotify(xcb_motion_notify_event_t *ev) {
             event_drawable_under_mouse(L, -1);
             lua_pushinteger(L, x);
             lua_pushinteger(L, y);
-            luna_object_emit_signal(L, -3, ":mouse.move", 2);
+            luna_object_emit_signal_id(L, -3, LUNA_SIGNAL(":mouse.move"), 2);
             lua_pop(L, 1);
         }
         lua_pop(L, 1);
@@ -495,7 +494,7 @@ static void event_handle_motionnotify(xcb_motion_notify_event_t *ev) {
         event_drawable_under_mouse(L, -1);
         lua_pushinteger(L, ev->event_x);
         lua_pushinteger(L, ev->event_y);
-        luna_object_emit_signal(L, -3, ":mouse.move", 2);
+        luna_object_emit_signal_id(L, -3, LUNA_SIGNAL(":mouse.move"), 2);
         lua_pop(L, 2);
     }
 }
@@ -531,7 +530,7 @@ static void event_handle_leavenotify(xcb_leave_notify_event_t *ev) {
          */
         if (ev->detail != XCB_NOTIFY_DETAIL_INFERIOR) {
             luna_object_push(L, c);
-            luna_object_emit_signal(L, -1, ":mouse.leave", 0);
+            luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":mouse.leave"), 0);
             lua_pop(L, 1);
         }
     } else if (ev->detail != XCB_NOTIFY_DETAIL_INFERIOR) {
@@ -585,7 +584,7 @@ static void event_handle_enternotify(xcb_enter_notify_event_t *ev) {
          * other details mean that the client itself was really left.
          */
         if (ev->detail != XCB_NOTIFY_DETAIL_INFERIOR) {
-            luna_object_emit_signal(L, -1, ":mouse.enter", 0);
+            luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":mouse.enter"), 0);
         }
 
         drawable_t *d = client_get_drawable(c, ev->event_x, ev->event_y);
@@ -693,6 +692,7 @@ static void event_handle_maprequest(xcb_map_request_event_t *ev) {
     xcb_get_window_attributes_reply_t *wa_r;
     xcb_get_geometry_cookie_t          geom_c;
     xcb_get_geometry_reply_t          *geom_r;
+    client_manage_cookies_t            cookies;
 
     wa_c = xcb_get_window_attributes_unchecked(globalconf.connection, ev->window);
 
@@ -700,7 +700,7 @@ static void event_handle_maprequest(xcb_map_request_event_t *ev) {
 
     if (wa_r->override_redirect) goto bailout;
 
-    if ((em = xembed_getbywin(&globalconf.embedded, ev->window))) {
+    if ((em = systray_getbywin(ev->window))) {
         xcb_map_window(globalconf.connection, ev->window);
         xembed_window_activate(globalconf.connection, ev->window, globalconf.timestamp);
         /* The correct way to set this is via the _XEMBED_INFO property. Neither
@@ -722,12 +722,15 @@ static void event_handle_maprequest(xcb_map_request_event_t *ev) {
         }
     } else {
         geom_c = xcb_get_geometry_unchecked(globalconf.connection, ev->window);
+        client_manage_prefetch(ev->window, &cookies);
 
         if (!(geom_r = xcb_get_geometry_reply(globalconf.connection, geom_c, NULL))) {
+            client_manage_discard(&cookies);
             goto bailout;
         }
 
-        client_manage(ev->window, geom_r, wa_r);
+        client_manage(ev->window, geom_r, wa_r, &cookies);
+        client_manage_check(ev->window, &cookies);
 
         p_delete(&geom_r);
     }
@@ -805,7 +808,7 @@ static void event_handle_randr_output_change_notify(xcb_randr_notify_event_t *ev
             L, (char *)xcb_randr_get_output_info_name(info),
             xcb_randr_get_output_info_name_length(info));
         lua_pushstring(L, connection_str);
-        luna_emit_global_signal(L, ":screen.change", 2);
+        luna_emit_global_signal_id(L, LUNA_SIGNAL(":screen.change"), 2);
 
         p_delete(&info);
 
@@ -823,9 +826,9 @@ static void event_handle_shape_notify(xcb_shape_notify_event_t *ev) {
         lua_State *L = globalconf_get_lua_State();
         luna_object_push(L, c);
         if (ev->shape_kind == XCB_SHAPE_SK_BOUNDING)
-            luna_object_emit_signal(L, -1, ":property.shape_client_bounding", 0);
+            luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.shape_client_bounding"), 0);
         if (ev->shape_kind == XCB_SHAPE_SK_CLIP)
-            luna_object_emit_signal(L, -1, ":property.shape_client_clip", 0);
+            luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.shape_client_clip"), 0);
         lua_pop(L, 1);
     }
 }
@@ -860,12 +863,8 @@ static void event_handle_reparentnotify(xcb_reparent_notify_event_t *ev) {
         if (ev->parent != globalconf.screen->root) client_unmanage(c, CLIENT_UNMANAGE_REPARENT);
     } else if (ev->parent != globalconf.systray.window) {
         /* Embedded window moved elsewhere, end of embedding */
-        for (int i = 0; i < globalconf.embedded.len; i++)
-            if (globalconf.embedded.tab[i].win == ev->window) {
-                xembed_window_array_take(&globalconf.embedded, i);
-                xcb_change_save_set(globalconf.connection, XCB_SET_MODE_DELETE, ev->window);
-                luaA_systray_invalidate();
-            }
+        if (systray_remove(ev->window))
+            xcb_change_save_set(globalconf.connection, XCB_SET_MODE_DELETE, ev->window);
     }
 }
 
@@ -936,7 +935,7 @@ static bool should_ignore(xcb_generic_event_t *event) {
     return false;
 }
 
-void event_handle(xcb_generic_event_t *event) {
+static void event_dispatch(xcb_generic_event_t *event) {
     uint8_t response_type = XCB_EVENT_RESPONSE_TYPE(event);
 
     if (should_ignore(event)) return;
@@ -987,6 +986,203 @@ void event_handle(xcb_generic_event_t *event) {
 #undef EXTENSION_EVENT
 }
 
+/** Get the window an event is about, for tracing.
+ * \param event The event.
+ * \return The window, or XCB_NONE.
+ */
+static xcb_window_t event_get_window(xcb_generic_event_t *event) {
+    switch (XCB_EVENT_RESPONSE_TYPE(event)) {
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+        case XCB_MOTION_NOTIFY:
+            return ((xcb_button_press_event_t *)event)->event;
+        case XCB_ENTER_NOTIFY:
+        case XCB_LEAVE_NOTIFY:
+            return ((xcb_enter_notify_event_t *)event)->event;
+        case XCB_FOCUS_IN:
+            return ((xcb_focus_in_event_t *)event)->event;
+        case XCB_EXPOSE:
+            return ((xcb_expose_event_t *)event)->window;
+        case XCB_CONFIGURE_REQUEST:
+            return ((xcb_configure_request_event_t *)event)->window;
+        case XCB_CONFIGURE_NOTIFY:
+            return ((xcb_configure_notify_event_t *)event)->window;
+        case XCB_DESTROY_NOTIFY:
+            return ((xcb_destroy_notify_event_t *)event)->window;
+        case XCB_UNMAP_NOTIFY:
+            return ((xcb_unmap_notify_event_t *)event)->window;
+        case XCB_MAP_REQUEST:
+            return ((xcb_map_request_event_t *)event)->window;
+        case XCB_REPARENT_NOTIFY:
+            return ((xcb_reparent_notify_event_t *)event)->window;
+        case XCB_PROPERTY_NOTIFY:
+            return ((xcb_property_notify_event_t *)event)->window;
+        case XCB_CLIENT_MESSAGE:
+            return ((xcb_client_message_event_t *)event)->window;
+    }
+    return XCB_NONE;
+}
+
+/** How far back to look for an event to merge with. */
+#define EVENT_COALESCE_LOOKBACK 256
+
+/** Find the closest earlier event about a window.
+ * \param events The events.
+ * \param pos Look before this index.
+ * \param limit Do not look before this index.
+ * \param window The window.
+ * \return The index of the event, or -1.
+ */
+static int
+event_find_previous(xcb_generic_event_t **events, int pos, int limit, xcb_window_t window) {
+    for (int i = pos - 1; i >= limit; i--)
+        if (events[i] && event_get_window(events[i]) == window) return i;
+    return -1;
+}
+
+/** Add the values of an earlier ConfigureRequest which a later one does not
+ * set to it.
+ * \param into The later request.
+ * \param from The earlier request.
+ */
+static void event_merge_configurerequest(
+    xcb_configure_request_event_t *into, const xcb_configure_request_event_t *from) {
+    uint16_t missing = from->value_mask & ~into->value_mask;
+
+    /* The sibling only means something with the stack mode it came with */
+    if (into->value_mask & XCB_CONFIG_WINDOW_STACK_MODE) missing &= ~XCB_CONFIG_WINDOW_SIBLING;
+
+    if (missing & XCB_CONFIG_WINDOW_X) into->x = from->x;
+    if (missing & XCB_CONFIG_WINDOW_Y) into->y = from->y;
+    if (missing & XCB_CONFIG_WINDOW_WIDTH) into->width = from->width;
+    if (missing & XCB_CONFIG_WINDOW_HEIGHT) into->height = from->height;
+    if (missing & XCB_CONFIG_WINDOW_BORDER_WIDTH) into->border_width = from->border_width;
+    if (missing & XCB_CONFIG_WINDOW_SIBLING) into->sibling = from->sibling;
+    if (missing & XCB_CONFIG_WINDOW_STACK_MODE) into->stack_mode = from->stack_mode;
+    into->value_mask |= missing;
+}
+
+/** Grow a later Expose to also cover an earlier one.
+ * \param into The later event.
+ * \param from The earlier event.
+ */
+static void event_merge_expose(xcb_expose_event_t *into, const xcb_expose_event_t *from) {
+    int x1 = MIN(into->x, from->x);
+    int y1 = MIN(into->y, from->y);
+    int x2 = MAX(into->x + into->width, from->x + from->width);
+    int y2 = MAX(into->y + into->height, from->y + from->height);
+
+    into->x      = x1;
+    into->y      = y1;
+    into->width  = x2 - x1;
+    into->height = y2 - y1;
+}
+
+/** Check if a crossing event changes nothing when it is dropped together with
+ * the opposite one.
+ * \param ev The EnterNotify or LeaveNotify.
+ */
+static bool event_crossing_is_cancellable(const xcb_enter_notify_event_t *ev) {
+    return ev->mode == XCB_NOTIFY_MODE_NORMAL && ev->detail != XCB_NOTIFY_DETAIL_INFERIOR &&
+           ev->event != globalconf.screen->root;
+}
+
+/** Merge events of a batch which only the last one of matters.
+ *
+ * A ConfigureRequest is merged into the next one for the same window, unless
+ * something else happened to the window in between. Exposes of a window are
+ * merged into the last one, which covers all of their areas, so the window is
+ * only copied to once. When the pointer just passed through a window, its
+ * EnterNotify and LeaveNotify are both dropped. A PropertyNotify of a client
+ * is dropped when the same property of it changes again before anything else
+ * happens to the client, since the handler only reads the current value.
+ *
+ * Merged events are freed and replaced with NULL.
+ * \param events The events, in the order they were received.
+ * \param count The number of events.
+ */
+void event_coalesce(xcb_generic_event_t **events, int count) {
+    for (int i = 0; i < count; i++) {
+        xcb_generic_event_t *event = events[i];
+        uint8_t              type  = XCB_EVENT_RESPONSE_TYPE(event);
+        int                  limit = MAX(i - EVENT_COALESCE_LOOKBACK, 0);
+        int                  prev;
+
+        switch (type) {
+            case XCB_CONFIGURE_REQUEST: {
+                xcb_configure_request_event_t *ev = (void *)event;
+                prev = event_find_previous(events, i, limit, ev->window);
+                if (prev < 0 || XCB_EVENT_RESPONSE_TYPE(events[prev]) != XCB_CONFIGURE_REQUEST)
+                    break;
+                event_merge_configurerequest(ev, (void *)events[prev]);
+                p_delete(&events[prev]);
+                globalconf.coalesce_count.configure_request++;
+                break;
+            }
+            case XCB_EXPOSE: {
+                xcb_expose_event_t *ev = (void *)event;
+                prev                   = i;
+                while ((prev = event_find_previous(events, prev, limit, ev->window)) >= 0)
+                    if (XCB_EVENT_RESPONSE_TYPE(events[prev]) == XCB_EXPOSE) break;
+                if (prev < 0) break;
+                event_merge_expose(ev, (void *)events[prev]);
+                p_delete(&events[prev]);
+                globalconf.coalesce_count.expose++;
+                break;
+            }
+            case XCB_LEAVE_NOTIFY: {
+                xcb_leave_notify_event_t *ev = (void *)event;
+                if (!event_crossing_is_cancellable(ev)) break;
+                prev = event_find_previous(events, i, limit, ev->event);
+                if (prev < 0 || XCB_EVENT_RESPONSE_TYPE(events[prev]) != XCB_ENTER_NOTIFY ||
+                    !event_crossing_is_cancellable((void *)events[prev]))
+                    break;
+                p_delete(&events[prev]);
+                p_delete(&events[i]);
+                globalconf.coalesce_count.enter_leave += 2;
+                break;
+            }
+            case XCB_PROPERTY_NOTIFY: {
+                xcb_property_notify_event_t *ev = (void *)event;
+                /* The root window and our own windows count their changes */
+                if (!client_getbywin(ev->window)) break;
+                prev = i;
+                while ((prev = event_find_previous(events, prev, limit, ev->window)) >= 0)
+                    if (XCB_EVENT_RESPONSE_TYPE(events[prev]) != XCB_PROPERTY_NOTIFY ||
+                        ((xcb_property_notify_event_t *)events[prev])->atom == ev->atom)
+                        break;
+                if (prev < 0 || XCB_EVENT_RESPONSE_TYPE(events[prev]) != XCB_PROPERTY_NOTIFY)
+                    break;
+                p_delete(&events[prev]);
+                globalconf.coalesce_count.property_notify++;
+                break;
+            }
+        }
+    }
+}
+
+/** Handle an X event or error.
+ * \param event The event.
+ */
+void event_handle(xcb_generic_event_t *event) {
+    if (likely(!trace_buffer)) {
+        event_dispatch(event);
+        return;
+    }
+
+    int64_t     start = trace_now();
+    const char *label = xcb_event_get_label(XCB_EVENT_RESPONSE_TYPE(event));
+
+    event_dispatch(event);
+
+    if (trace_buffer)
+        trace_span(
+            "event", label ? label : "ExtensionEvent", start, trace_now(), "window",
+            event_get_window(event));
+}
+
 void event_init(void) {
     const xcb_query_extension_reply_t *reply;
 
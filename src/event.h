@@ -25,11 +25,15 @@
 
 #include "banning.h"
 #include "globalconf.h"
+#include "loopstats.h"
 #include "stack.h"
 
 #include <xcb/xcb.h>
 
+DO_ARRAY(xcb_generic_event_t *, event, DO_NOTHING)
+
 /* luaa.c */
+void luaA_emit_property_signals(void);
 void luaA_emit_refresh(void);
 
 /* objects/drawin.c */
@@ -41,17 +45,31 @@ void client_focus_refresh(void);
 void client_destroy_later(void);
 
 static inline int awesome_refresh(void) {
+    int64_t t = loop_stats_now();
+    int     res;
+
+    luaA_emit_property_signals();
+    t = loop_stats_record(LOOP_PHASE_SIGNALS, t);
     luaA_emit_refresh();
+    t = loop_stats_record(LOOP_PHASE_REFRESH, t);
     drawin_refresh();
+    t = loop_stats_record(LOOP_PHASE_DRAWIN, t);
     client_refresh();
+    t = loop_stats_record(LOOP_PHASE_CLIENT, t);
     banning_refresh();
+    t = loop_stats_record(LOOP_PHASE_BANNING, t);
     stack_refresh();
+    t = loop_stats_record(LOOP_PHASE_STACK, t);
     client_destroy_later();
-    return xcb_flush(globalconf.connection);
+    t   = loop_stats_record(LOOP_PHASE_DESTROY_LATER, t);
+    res = xcb_flush(globalconf.connection);
+    loop_stats_record(LOOP_PHASE_FLUSH, t);
+    return res;
 }
 
 void event_init(void);
 void event_handle(xcb_generic_event_t *);
+void event_coalesce(xcb_generic_event_t **, int);
 void event_drawable_under_mouse(lua_State *, int);
 
 #endif
@@ -489,32 +489,40 @@ void ewmh_update_window_type(xcb_window_t window, uint32_t type) {
         32, 1, &type);
 }
 
-void ewmh_client_check_hints(client_t *c) {
+/** Send the requests for the hints applied to a new client.
+ * \param w The client window.
+ * \param cookies Where to store the cookies.
+ */
+void ewmh_client_hints_get_unchecked(xcb_window_t w, ewmh_hints_cookies_t *cookies) {
+    cookies->desktop = xcb_get_property_unchecked(
+        globalconf.connection, false, w, _NET_WM_DESKTOP, XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
+
+    cookies->state = xcb_get_property_unchecked(
+        globalconf.connection, false, w, _NET_WM_STATE, XCB_ATOM_ATOM, 0, UINT32_MAX);
+
+    cookies->window_type = xcb_get_property_unchecked(
+        globalconf.connection, false, w, _NET_WM_WINDOW_TYPE, XCB_ATOM_ATOM, 0, UINT32_MAX);
+}
+
+/** Apply the desktop, state and window type hints of a new client.
+ * \param c The client.
+ * \param cookies Cookies from ewmh_client_hints_get_unchecked().
+ */
+void ewmh_client_check_hints(client_t *c, ewmh_hints_cookies_t *cookies) {
     xcb_atom_t               *state;
     void                     *data = NULL;
-    xcb_get_property_cookie_t c0, c1, c2;
     xcb_get_property_reply_t *reply;
     bool                      is_h_max = false;
     bool                      is_v_max = false;
 
-    /* Send the GetProperty requests which will be processed later */
-    c0                                 = xcb_get_property_unchecked(
-        globalconf.connection, false, c->window, _NET_WM_DESKTOP, XCB_GET_PROPERTY_TYPE_ANY, 0, 1);
-
-    c1 = xcb_get_property_unchecked(
-        globalconf.connection, false, c->window, _NET_WM_STATE, XCB_ATOM_ATOM, 0, UINT32_MAX);
-
-    c2 = xcb_get_property_unchecked(
-        globalconf.connection, false, c->window, _NET_WM_WINDOW_TYPE, XCB_ATOM_ATOM, 0, UINT32_MAX);
-
-    reply = xcb_get_property_reply(globalconf.connection, c0, NULL);
+    reply = xcb_get_property_reply(globalconf.connection, cookies->desktop, NULL);
     if (reply && reply->value_len && (data = xcb_get_property_value(reply))) {
         ewmh_process_desktop(c, *(uint32_t *)data);
     }
 
     p_delete(&reply);
 
-    reply = xcb_get_property_reply(globalconf.connection, c1, NULL);
+    reply = xcb_get_property_reply(globalconf.connection, cookies->state, NULL);
     if (reply && (data = xcb_get_property_value(reply))) {
         state = (xcb_atom_t *)data;
         for (int i = 0; i < xcb_get_property_value_length(reply) / ssizeof(xcb_atom_t); i++)
@@ -543,7 +551,7 @@ void ewmh_client_check_hints(client_t *c) {
 
     p_delete(&reply);
 
-    reply = xcb_get_property_reply(globalconf.connection, c2, NULL);
+    reply = xcb_get_property_reply(globalconf.connection, cookies->window_type, NULL);
     if (reply && (data = xcb_get_property_value(reply))) {
         c->has_NET_WM_WINDOW_TYPE = true;
         state                     = (xcb_atom_t *)data;
@@ -565,16 +573,24 @@ void ewmh_client_check_hints(client_t *c) {
     p_delete(&reply);
 }
 
+/** Send request to get the WM strut of a window.
+ * \param w The window.
+ * \return The cookie associated with the request.
+ */
+xcb_get_property_cookie_t ewmh_client_strut_get_unchecked(xcb_window_t w) {
+    return xcb_get_property_unchecked(
+        globalconf.connection, false, w, _NET_WM_STRUT_PARTIAL, XCB_ATOM_CARDINAL, 0, 12);
+}
+
 /** Process the WM strut of a client.
  * \param c The client.
+ * \param cookie Cookie from ewmh_client_strut_get_unchecked().
  */
-void ewmh_process_client_strut(client_t *c) {
+void ewmh_process_client_strut(client_t *c, xcb_get_property_cookie_t cookie) {
     void                     *data;
     xcb_get_property_reply_t *strut_r;
 
-    xcb_get_property_cookie_t strut_q = xcb_get_property_unchecked(
-        globalconf.connection, false, c->window, _NET_WM_STRUT_PARTIAL, XCB_ATOM_CARDINAL, 0, 12);
-    strut_r = xcb_get_property_reply(globalconf.connection, strut_q, NULL);
+    strut_r = xcb_get_property_reply(globalconf.connection, cookie, NULL);
 
     if (strut_r && strut_r->value_len && (data = xcb_get_property_value(strut_r))) {
         uint32_t *strut = data;
@@ -608,60 +624,133 @@ void ewmh_process_client_strut(client_t *c) {
     p_delete(&strut_r);
 }
 
-/** Send request to get NET_WM_ICON (EWMH)
+/** The most images read from _NET_WM_ICON, so that a broken property cannot
+ * keep us busy */
+#define EWMH_ICON_MAX_IMAGES 64
+
+/** Send request to check for NET_WM_ICON (EWMH). Only the header of the first
+ * image is requested, images are only read once they are needed.
  * \param w The window.
  * \return The cookie associated with the request.
  */
 xcb_get_property_cookie_t ewmh_window_icon_get_unchecked(xcb_window_t w) {
     return xcb_get_property_unchecked(
-        globalconf.connection, false, w, _NET_WM_ICON, XCB_ATOM_CARDINAL, 0, UINT32_MAX);
+        globalconf.connection, false, w, _NET_WM_ICON, XCB_ATOM_CARDINAL, 0, 2);
 }
 
-static cairo_surface_t *ewmh_window_icon_from_reply_next(uint32_t **data, uint32_t *data_end) {
-    uint32_t  width, height;
+/** Parse the header of an image of NET_WM_ICON.
+ * \param r The reply to a request for the 2 values at offset.
+ * \param offset The offset of the header in the property.
+ * \param icon Where to store the image size and position.
+ * \return True if there is a complete image at offset.
+ */
+static bool ewmh_window_icon_read_header(
+    xcb_get_property_reply_t *r, uint32_t offset, ewmh_icon_t *icon) {
+    uint32_t *data;
     uint64_t  data_len;
-    uint32_t *icon_data;
 
-    if (data_end - *data <= 2) return NULL;
+    if (!r || r->type != XCB_ATOM_CARDINAL || r->format != 32 || r->value_len < 2) return false;
 
-    width    = (*data)[0];
-    height   = (*data)[1];
+    data     = (uint32_t *)xcb_get_property_value(r);
 
-    /* Check that we have enough data, handling overflow */
-    data_len = width * (uint64_t)height;
-    if (width < 1 || height < 1 || data_len > (uint64_t)(data_end - *data) - 2) return NULL;
+    /* Check that the property has enough data, handling overflow */
+    data_len = data[0] * (uint64_t)data[1];
+    if (data[0] < 1 || data[1] < 1 || data_len > r->bytes_after / 4) return false;
 
-    icon_data = *data + 2;
-    *data += 2 + data_len;
-    return draw_surface_from_data(width, height, icon_data);
+    icon->width  = data[0];
+    icon->height = data[1];
+    icon->offset = offset + 2;
+    return true;
 }
 
-static cairo_surface_array_t ewmh_window_icon_from_reply(xcb_get_property_reply_t *r) {
-    uint32_t             *data, *data_end;
-    cairo_surface_array_t result;
-    cairo_surface_t      *s;
+/** Check that NET_WM_ICON holds an icon.
+ * \param cookie The cookie from ewmh_window_icon_get_unchecked().
+ * \return True if it does.
+ */
+bool ewmh_window_icon_check_reply(xcb_get_property_cookie_t cookie) {
+    xcb_get_property_reply_t *r = xcb_get_property_reply(globalconf.connection, cookie, NULL);
+    ewmh_icon_t               icon;
+    bool                      ret = ewmh_window_icon_read_header(r, 0, &icon);
+
+    p_delete(&r);
+    return ret;
+}
 
-    cairo_surface_array_init(&result);
-    if (!r || r->type != XCB_ATOM_CARDINAL || r->format != 32) return result;
+/** How much of NET_WM_ICON is read at once when looking for the headers of its
+ * images, in 32 bit units. Small images fit into one read together, so the
+ * usual icons only take one round trip. */
+#define EWMH_ICON_HEADER_CHUNK 8192
 
-    data     = (uint32_t *)xcb_get_property_value(r);
-    data_end = &data[r->length];
-    if (!data) return result;
+/** Get the sizes of the images in NET_WM_ICON. The property is read in chunks
+ * of bounded size, a new one starting at the first header which was not in
+ * the last one.
+ * \param w The window.
+ * \return The size and position of each image.
+ */
+ewmh_icon_array_t ewmh_window_icon_get_headers(xcb_window_t w) {
+    ewmh_icon_array_t result;
+    uint32_t          offset = 0;
+    bool              done   = false;
+
+    ewmh_icon_array_init(&result);
+    while (!done && result.len < EWMH_ICON_MAX_IMAGES) {
+        xcb_get_property_cookie_t cookie = xcb_get_property_unchecked(
+            globalconf.connection, false, w, _NET_WM_ICON, XCB_ATOM_CARDINAL, offset,
+            EWMH_ICON_HEADER_CHUNK);
+        xcb_get_property_reply_t *r = xcb_get_property_reply(globalconf.connection, cookie, NULL);
+
+        if (!r || r->type != XCB_ATOM_CARDINAL || r->format != 32) {
+            p_delete(&r);
+            break;
+        }
+
+        uint32_t *data = (uint32_t *)xcb_get_property_value(r);
+        uint64_t  len  = r->value_len;
+        /* What is left of the property from offset on */
+        uint64_t  left = len + r->bytes_after / 4;
+        uint64_t  pos  = 0;
+
+        done           = true;
+        while (result.len < EWMH_ICON_MAX_IMAGES && pos + 2 <= left) {
+            /* The header is not in this chunk, start the next one with it */
+            if (pos + 2 > len) {
+                done = false;
+                break;
+            }
+
+            /* Check that the property has enough data, handling overflow */
+            uint64_t data_len = data[pos] * (uint64_t)data[pos + 1];
+            if (data[pos] < 1 || data[pos + 1] < 1 || data_len > left - pos - 2) break;
+
+            ewmh_icon_t icon = {
+                .width = data[pos], .height = data[pos + 1], .offset = offset + pos + 2};
+            ewmh_icon_array_append(&result, icon);
+            pos += 2 + data_len;
+        }
 
-    while ((s = ewmh_window_icon_from_reply_next(&data, data_end)) != NULL) {
-        cairo_surface_array_push(&result, s);
+        p_delete(&r);
+        offset += pos;
     }
 
     return result;
 }
 
-/** Get NET_WM_ICON.
- * \param cookie The cookie.
- * \return An array of icons.
+/** Get one image of NET_WM_ICON.
+ * \param w The window.
+ * \param icon The image, from ewmh_window_icon_get_headers().
+ * \return A new surface, or NULL if the property changed since the header was
+ * read.
  */
-cairo_surface_array_t ewmh_window_icon_get_reply(xcb_get_property_cookie_t cookie) {
+cairo_surface_t *ewmh_window_icon_get_image(xcb_window_t w, ewmh_icon_t *icon) {
+    uint32_t                  len    = icon->width * icon->height;
+    xcb_get_property_cookie_t cookie = xcb_get_property_unchecked(
+        globalconf.connection, false, w, _NET_WM_ICON, XCB_ATOM_CARDINAL, icon->offset, len);
     xcb_get_property_reply_t *r      = xcb_get_property_reply(globalconf.connection, cookie, NULL);
-    cairo_surface_array_t     result = ewmh_window_icon_from_reply(r);
+    cairo_surface_t          *result = NULL;
+
+    if (r && r->type == XCB_ATOM_CARDINAL && r->format == 32 && r->value_len == len)
+        result = draw_surface_from_data(icon->width, icon->height, xcb_get_property_value(r));
+
     p_delete(&r);
     return result;
 }
@@ -26,10 +26,24 @@
 #include <cairo.h>
 #include <xcb/xcb.h>
 
+#include "common/array.h"
 #include "strut.h"
 
-typedef struct client_t              client_t;
-typedef struct cairo_surface_array_t cairo_surface_array_t;
+typedef struct client_t client_t;
+
+/** One of the images of _NET_WM_ICON, as found from its header */
+typedef struct {
+    uint32_t width, height;
+    /** Where the pixels start in the property, in 32 bit units */
+    uint32_t offset;
+} ewmh_icon_t;
+
+DO_ARRAY(ewmh_icon_t, ewmh_icon, DO_NOTHING)
+
+/** Requests for the hints ewmh_client_check_hints() applies */
+typedef struct {
+    xcb_get_property_cookie_t desktop, state, window_type;
+} ewmh_hints_cookies_t;
 
 void                      ewmh_init(void);
 void                      ewmh_init_lua(void);
@@ -38,13 +52,17 @@ int                       ewmh_update_net_current_desktop(lua_State *);
 void                      ewmh_update_net_desktop_names(void);
 int                       ewmh_process_client_message(xcb_client_message_event_t *);
 void                      ewmh_update_net_client_list_stacking(void);
-void                      ewmh_client_check_hints(client_t *);
+void                      ewmh_client_hints_get_unchecked(xcb_window_t, ewmh_hints_cookies_t *);
+void                      ewmh_client_check_hints(client_t *, ewmh_hints_cookies_t *);
 void                      ewmh_client_update_desktop(client_t *);
-void                      ewmh_process_client_strut(client_t *);
+xcb_get_property_cookie_t ewmh_client_strut_get_unchecked(xcb_window_t);
+void                      ewmh_process_client_strut(client_t *, xcb_get_property_cookie_t);
 void                      ewmh_update_strut(xcb_window_t, strut_t *);
 void                      ewmh_update_window_type(xcb_window_t window, uint32_t type);
 xcb_get_property_cookie_t ewmh_window_icon_get_unchecked(xcb_window_t);
-cairo_surface_array_t     ewmh_window_icon_get_reply(xcb_get_property_cookie_t);
+bool                      ewmh_window_icon_check_reply(xcb_get_property_cookie_t);
+ewmh_icon_array_t         ewmh_window_icon_get_headers(xcb_window_t);
+cairo_surface_t          *ewmh_window_icon_get_image(xcb_window_t, ewmh_icon_t *);
 
 #endif
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -36,7 +36,9 @@
 #include <xcb/xcb_errors.h>
 #endif
 
+#include "common/bitset.h"
 #include "common/buffer.h"
+#include "common/refcount.h"
 #include "common/xembed.h"
 #include "draw.h"
 
@@ -122,6 +124,10 @@ typedef struct {
     bool                  have_xkb;
     /** Check for XFixes extension */
     bool                  have_xfixes;
+    /** Check for MIT-SHM extension */
+    bool                  have_shm;
+    /** Should new drawables draw into MIT-SHM segments? */
+    bool                  drawable_shm;
     /** Custom searchpaths are present, the runtime is tinted */
     bool                  have_searchpaths;
     /** When --no-argb is used in the modeline or command line */
@@ -195,6 +201,8 @@ typedef struct {
     bool                  need_lazy_banning;
     /** Tag list */
     tag_array_t           tags;
+    /** Bits of the activated and selected tags */
+    bitset_t              selected_tags;
     /** List of registered xproperties */
     xproperty_array_t     xproperties;
     /* xkb context */
@@ -213,6 +221,8 @@ typedef struct {
     uint32_t              preferred_icon_size;
     /** Cached wallpaper information */
     cairo_surface_t      *wallpaper;
+    /** The wallpaper pixmap if drawables can copy from it, else XCB_NONE */
+    xcb_pixmap_t          wallpaper_pixmap;
     /** List of enter/leave events to ignore */
     sequence_pair_array_t ignore_enter_leave_events;
     xcb_void_cookie_t     pending_enter_leave_begin;
@@ -224,6 +234,26 @@ typedef struct {
     int                   exit_code;
     /** The Global API level */
     int                   api_level;
+    /** Number of objects each refresh phase processed since startup */
+    struct {
+        /** Clients whose geometry was refreshed */
+        unsigned long geometry;
+        /** Windows whose border was refreshed */
+        unsigned long border;
+        /** Drawins whose geometry was refreshed */
+        unsigned long drawin;
+    } refresh_count;
+    /** Number of events dropped by merging them with others since startup */
+    struct {
+        /** ConfigureRequests merged into a later one for the same window */
+        unsigned long configure_request;
+        /** Exposes merged into a later one for the same window */
+        unsigned long expose;
+        /** EnterNotifies and LeaveNotifies which cancelled each other */
+        unsigned long enter_leave;
+        /** PropertyNotifies followed by one for the same window and atom */
+        unsigned long property_notify;
+    } coalesce_count;
 } awesome_t;
 
 extern awesome_t globalconf;
@@ -237,6 +267,7 @@ static inline lua_State *globalconf_get_lua_State(void) {
 
 /* Defined in root.c */
 void root_update_wallpaper(void);
+void root_wallpaper_changed(void);
 
 #endif
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,104 @@
+/*
+ * loopstats.c - main loop timing statistics
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Every phase of a main loop iteration records how long it took into a
+ * histogram with power of two buckets, so that the phase responsible for a
+ * slow iteration can be told apart from the others. */
+
+#include "loopstats.h"
+#include "common/trace.h"
+#include "common/util.h"
+
+#include <time.h>
+
+static loop_phase_stats_t loop_stats[LOOP_PHASE_COUNT];
+
+static const char *const loop_phase_names[LOOP_PHASE_COUNT] = {
+    [LOOP_PHASE_SIGNALS]       = "signals",
+    [LOOP_PHASE_REFRESH]       = "refresh",
+    [LOOP_PHASE_DRAWIN]        = "drawin",
+    [LOOP_PHASE_CLIENT]        = "client",
+    [LOOP_PHASE_BANNING]       = "banning",
+    [LOOP_PHASE_STACK]         = "stack",
+    [LOOP_PHASE_DESTROY_LATER] = "destroy_later",
+    [LOOP_PHASE_FLUSH]         = "flush",
+    [LOOP_PHASE_POLL]          = "poll",
+    [LOOP_PHASE_EVENTS]        = "events",
+    [LOOP_PHASE_WALLPAPER]     = "wallpaper",
+};
+
+/** Get the current time of the monotonic clock.
+ * \return The time in nanoseconds.
+ */
+int64_t loop_stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** Record the duration of a phase.
+ * \param phase The phase.
+ * \param start When the phase started, as returned by loop_stats_now().
+ * \return The current time, which is when the next phase starts.
+ */
+int64_t loop_stats_record(loop_phase_t phase, int64_t start) {
+    int64_t             now   = loop_stats_now();
+    uint64_t            ns    = now > start ? now - start : 0;
+    uint64_t            us    = ns / 1000;
+    loop_phase_stats_t *stats = &loop_stats[phase];
+
+    /* us is in [2^(i-1), 2^i) for bucket i, bucket 0 is everything below 1µs */
+    int bucket = us ? 64 - __builtin_clzll(us) : 0;
+    if (bucket >= LOOP_STATS_BUCKETS) bucket = LOOP_STATS_BUCKETS - 1;
+
+    stats->count++;
+    stats->total += ns;
+    if (ns > stats->max) stats->max = ns;
+    stats->buckets[bucket]++;
+
+    if (trace_buffer) trace_span("loop", loop_phase_names[phase], start, now, NULL, 0);
+
+    return now;
+}
+
+/** Get the statistics of a phase.
+ * \param phase The phase.
+ * \return The statistics recorded since startup or the last reset.
+ */
+const loop_phase_stats_t *loop_stats_get(loop_phase_t phase) {
+    return &loop_stats[phase];
+}
+
+/** Get the name of a phase.
+ * \param phase The phase.
+ * \return The name, as seen from Lua.
+ */
+const char *loop_phase_name(loop_phase_t phase) {
+    return loop_phase_names[phase];
+}
+
+/** Forget about all recorded durations.
+ */
+void loop_stats_reset(void) {
+    p_clear(loop_stats, LOOP_PHASE_COUNT);
+}
+
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,67 @@
+/*
+ * loopstats.h - main loop timing statistics header
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AWESOME_LOOPSTATS_H
+#define AWESOME_LOOPSTATS_H
+
+#include <stdint.h>
+
+/** Timed phases of a main loop iteration, in the order they run. */
+typedef enum {
+    /** Property signals coalesced since the last iteration */
+    LOOP_PHASE_SIGNALS,
+    /** The Lua "refresh" signal */
+    LOOP_PHASE_REFRESH,
+    LOOP_PHASE_DRAWIN,
+    LOOP_PHASE_CLIENT,
+    LOOP_PHASE_BANNING,
+    LOOP_PHASE_STACK,
+    LOOP_PHASE_DESTROY_LATER,
+    LOOP_PHASE_FLUSH,
+    /** Sleeping in g_poll() */
+    LOOP_PHASE_POLL,
+    /** Handling X events after waking up */
+    LOOP_PHASE_EVENTS,
+    /** Painting a wallpaper set from Lua, from idle callbacks */
+    LOOP_PHASE_WALLPAPER,
+    LOOP_PHASE_COUNT
+} loop_phase_t;
+
+/** Bucket i counts durations under 2^i microseconds, the last one is unbounded. */
+#define LOOP_STATS_BUCKETS 24
+
+typedef struct {
+    /** Number of recorded durations */
+    uint64_t count;
+    /** Sum and maximum of the recorded durations, in nanoseconds */
+    uint64_t total;
+    uint64_t max;
+    uint64_t buckets[LOOP_STATS_BUCKETS];
+} loop_phase_stats_t;
+
+int64_t                   loop_stats_now(void);
+int64_t                   loop_stats_record(loop_phase_t, int64_t);
+const loop_phase_stats_t *loop_stats_get(loop_phase_t);
+const char               *loop_phase_name(loop_phase_t);
+void                      loop_stats_reset(void);
+
+#endif
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -47,12 +47,14 @@
 #include "awesome.h"
 #include "common/backtrace.h"
 #include "common/signals.h"
+#include "common/trace.h"
 #include "common/version.h"
 #include "config.h"
 #include "dbus.h"
 #include "event.h"
 #include "globalconf.h"
 #include "keygrabber.h"
+#include "loopstats.h"
 #include "mouse.h"
 #include "mousegrabber.h"
 #include "objects/client.h"
@@ -69,6 +71,7 @@
 #include "root.h"
 #include "selection.h"
 #include "spawn.h"
+#include "stack.h"
 #include "systray.h"
 #include "xkb.h"
 #include "xrdb.h"
@@ -282,6 +285,87 @@ static int luaA_sync(lua_State *L) {
     return 0;
 }
 
+/** Get the time spent in each phase of the main loop.
+ *
+ * The result maps phase names (`signals`, `refresh`, `drawin`, `client`,
+ * `banning`, `stack`, `destroy_later`, `flush`, `poll`, `events` and
+ * `wallpaper`) to tables with the number of recorded iterations (`count`),
+ * their `total` and `max` duration in seconds and a `buckets` histogram.
+ * Bucket `i` counts the iterations that took less than 2^(i-1) microseconds,
+ * the last bucket counts all others. The `wallpaper` phase records each slice of painting a new
+ * wallpaper, which runs between main loop iterations.
+ *
+ * @tparam[opt=false] boolean reset Start over with empty statistics afterwards.
+ * @treturn table The statistics recorded since startup or the last reset.
+ * @staticfct loop_stats
+ */
+static int luaA_loop_stats(lua_State *L) {
+    bool reset = lua_toboolean(L, 1);
+
+    lua_createtable(L, 0, LOOP_PHASE_COUNT);
+    for (loop_phase_t phase = 0; phase < LOOP_PHASE_COUNT; phase++) {
+        const loop_phase_stats_t *stats = loop_stats_get(phase);
+
+        lua_createtable(L, 0, 4);
+        lua_pushinteger(L, stats->count);
+        lua_setfield(L, -2, "count");
+        lua_pushnumber(L, stats->total / 1e9);
+        lua_setfield(L, -2, "total");
+        lua_pushnumber(L, stats->max / 1e9);
+        lua_setfield(L, -2, "max");
+        lua_createtable(L, LOOP_STATS_BUCKETS, 0);
+        for (int i = 0; i < LOOP_STATS_BUCKETS; i++) {
+            lua_pushinteger(L, stats->buckets[i]);
+            lua_rawseti(L, -2, i + 1);
+        }
+        lua_setfield(L, -2, "buckets");
+        lua_setfield(L, -2, loop_phase_name(phase));
+    }
+
+    if (reset) loop_stats_reset();
+
+    return 1;
+}
+
+/** Start recording a trace of X event handling, signal emissions and main
+ * loop phases. It is written to a file in the Chrome trace event format when
+ * the trace stops, which can be opened in chrome://tracing or Perfetto.
+ *
+ * Only the most recent events are kept.
+ *
+ * @tparam string path Where to write the trace.
+ * @treturn boolean False if a trace is already being recorded.
+ * @staticfct trace_start
+ */
+static int luaA_trace_start(lua_State *L) {
+    size_t      len;
+    const char *path = luaL_checklstring(L, 1, &len);
+
+    luaL_argcheck(L, len > 0, 1, "empty path");
+    lua_pushboolean(L, trace_start(path));
+    return 1;
+}
+
+/** Stop recording a trace and write it out.
+ *
+ * @treturn boolean True if the trace was written.
+ * @treturn[opt] string The error message if writing the trace failed.
+ * @staticfct trace_stop
+ */
+static int luaA_trace_stop(lua_State *L) {
+    if (!trace_buffer) {
+        lua_pushboolean(L, false);
+        return 1;
+    }
+    if (!trace_stop()) {
+        lua_pushboolean(L, false);
+        lua_pushstring(L, strerror(errno));
+        return 2;
+    }
+    lua_pushboolean(L, true);
+    return 1;
+}
+
 /** Translate a GdkPixbuf to a cairo image surface..
  *
  * @param pixbuf The pixbuf as a light user datum.
@@ -339,6 +423,54 @@ static int luaA_set_preferred_icon_size(lua_State *L) {
     return 0;
 }
 
+/** Set whether new drawables draw into shared memory.
+ *
+ * This is the default for the `shm` property of drawables created afterwards.
+ * Drawables keep drawing into pixmaps when the X server does not support
+ * MIT-SHM.
+ *
+ * @tparam boolean enable Whether to use MIT-SHM.
+ * @treturn boolean Whether MIT-SHM is supported.
+ * @staticfct set_drawable_shm
+ */
+static int luaA_set_drawable_shm(lua_State *L) {
+    globalconf.drawable_shm = luaA_checkboolean(L, 1);
+    lua_pushboolean(L, drawable_shm_supported());
+    return 1;
+}
+
+/** Set how much memory pixmaps freed by drawable resizes may keep alive.
+ *
+ * These pixmaps are reused by later resizes to a size they fit. The default
+ * is 16 MiB, 0 disables the pool.
+ *
+ * @tparam integer bytes The limit in bytes.
+ * @staticfct set_drawable_pool_limit
+ * @noreturn
+ */
+static int luaA_set_drawable_pool_limit(lua_State *L) {
+    drawable_pool_set_limit(luaA_checkinteger_range(L, 1, 0, INT_MAX));
+    return 0;
+}
+
+/** Set whether property signals are coalesced per main loop iteration.
+ *
+ * While enabled, the `property::` signals of objects emitted by awesome itself
+ * are emitted once per object and property before the `refresh` signal,
+ * instead of every time the property changes. Slots of
+ * signals with arguments, such as the old geometry of screens, get the ones
+ * of the first change. Signals emitted with `emit_signal` are never delayed.
+ * This is disabled by default.
+ *
+ * @tparam boolean enable Whether to coalesce property signals.
+ * @staticfct set_property_signal_coalescing
+ * @noreturn
+ */
+static int luaA_set_property_signal_coalescing(lua_State *L) {
+    luna_signal_set_coalescing(L, luaA_checkboolean(L, 1));
+    return 0;
+}
+
 /** UTF-8 aware string length computing.
  * \param L The Lua VM state.
  * \return The number of elements pushed on stack.
@@ -664,6 +796,16 @@ static int luaA_get_active_modifiers(lua_State *L) {
  * @tfield string icon_path
  */
 
+/**
+ * Statistics of the pool of pixmaps freed by drawable resizes.
+ *
+ * The table has the number of `hits` and `misses` when a drawable needed a
+ * pixmap, the number of pooled `pixmaps`, the `bytes` they take and the
+ * `limit` set by `set_drawable_pool_limit`.
+ *
+ * @tfield table drawable_pool
+ */
+
 static int luaA_awesome_index(lua_State *L) {
     const char *buf = luaL_checkstring(L, 2);
 
@@ -702,6 +844,39 @@ static int luaA_awesome_index(lua_State *L) {
         return 1;
     }
 
+    if (A_STREQ(buf, "_restack_count")) {
+        lua_pushinteger(L, stack_restack_count());
+        return 1;
+    }
+
+    if (A_STREQ(buf, "_refresh_count")) {
+        lua_createtable(L, 0, 3);
+        lua_pushinteger(L, globalconf.refresh_count.geometry);
+        lua_setfield(L, -2, "geometry");
+        lua_pushinteger(L, globalconf.refresh_count.border);
+        lua_setfield(L, -2, "border");
+        lua_pushinteger(L, globalconf.refresh_count.drawin);
+        lua_setfield(L, -2, "drawin");
+        return 1;
+    }
+
+    if (A_STREQ(buf, "_coalesce_count")) {
+        lua_createtable(L, 0, 5);
+        lua_pushinteger(L, globalconf.coalesce_count.configure_request);
+        lua_setfield(L, -2, "configure_request");
+        lua_pushinteger(L, globalconf.coalesce_count.expose);
+        lua_setfield(L, -2, "expose");
+        lua_pushinteger(L, globalconf.coalesce_count.enter_leave);
+        lua_setfield(L, -2, "enter_leave");
+        lua_pushinteger(L, globalconf.coalesce_count.property_notify);
+        lua_setfield(L, -2, "property_notify");
+        lua_pushinteger(L, luna_signal_coalesced_count);
+        lua_setfield(L, -2, "property_signal");
+        return 1;
+    }
+
+    if (A_STREQ(buf, "drawable_pool")) return drawable_pool_push_stats(L);
+
     if (A_STREQ(buf, "startup_errors")) {
         if (globalconf.startup_errors.len == 0) return 0;
         lua_pushstring(L, globalconf.startup_errors.s);
@@ -981,28 +1156,34 @@ static void add_to_search_path(lua_State *L, string_array_t *searchpath, bool fo
 void luaA_init(xdgHandle *xdg, string_array_t *searchpath) {
     lua_State                   *L;
     static const struct luaL_Reg awesome_lib[] = {
-        {"quit",                    luaA_quit                     },
-        {"exec",                    luaA_exec                     },
-        {"spawn",                   luaA_spawn                    },
-        {"restart",                 luaA_restart                  },
-        {"connect_signal",          luaA_awesome_connect_signal   },
-        {"disconnect_signal",       luaA_awesome_disconnect_signal},
-        {"emit_signal",             luaA_awesome_emit_signal      },
-        {"systray",                 luaA_systray                  },
-        {"load_image",              luaA_load_image               },
-        {"pixbuf_to_surface",       luaA_pixbuf_to_surface        },
-        {"set_preferred_icon_size", luaA_set_preferred_icon_size  },
-        {"register_xproperty",      luaA_register_xproperty       },
-        {"set_xproperty",           luaA_set_xproperty            },
-        {"get_xproperty",           luaA_get_xproperty            },
-        {"xkb_set_layout_group",    luaA_xkb_set_layout_group     },
-        {"xkb_get_layout_group",    luaA_xkb_get_layout_group     },
-        {"xkb_get_group_names",     luaA_xkb_get_group_names      },
-        {"xrdb_get_value",          luaA_xrdb_get_value           },
-        {"kill",                    luaA_kill                     },
-        {"sync",                    luaA_sync                     },
-        {"_get_key_name",           luaA_get_key_name             },
-        {NULL,                      NULL                          }
+        {"quit",                           luaA_quit                          },
+        {"exec",                           luaA_exec                          },
+        {"spawn",                          luaA_spawn                         },
+        {"restart",                        luaA_restart                       },
+        {"connect_signal",                 luaA_awesome_connect_signal        },
+        {"disconnect_signal",              luaA_awesome_disconnect_signal     },
+        {"emit_signal",                    luaA_awesome_emit_signal           },
+        {"systray",                        luaA_systray                       },
+        {"load_image",                     luaA_load_image                    },
+        {"pixbuf_to_surface",              luaA_pixbuf_to_surface             },
+        {"set_preferred_icon_size",        luaA_set_preferred_icon_size       },
+        {"set_drawable_shm",               luaA_set_drawable_shm              },
+        {"set_drawable_pool_limit",        luaA_set_drawable_pool_limit       },
+        {"set_property_signal_coalescing", luaA_set_property_signal_coalescing},
+        {"register_xproperty",             luaA_register_xproperty            },
+        {"set_xproperty",                  luaA_set_xproperty                 },
+        {"get_xproperty",                  luaA_get_xproperty                 },
+        {"xkb_set_layout_group",           luaA_xkb_set_layout_group          },
+        {"xkb_get_layout_group",           luaA_xkb_get_layout_group          },
+        {"xkb_get_group_names",            luaA_xkb_get_group_names           },
+        {"xrdb_get_value",                 luaA_xrdb_get_value                },
+        {"kill",                           luaA_kill                          },
+        {"sync",                           luaA_sync                          },
+        {"loop_stats",                     luaA_loop_stats                    },
+        {"trace_start",                    luaA_trace_start                   },
+        {"trace_stop",                     luaA_trace_stop                    },
+        {"_get_key_name",                  luaA_get_key_name                  },
+        {NULL,                             NULL                               }
     };
 
     static const struct luaL_Reg awesome_meta[] = {
@@ -1199,9 +1380,21 @@ void luaA_emit_startup(void) {
     luna_emit_global_signal(L, "startup", 0);
 }
 
+/** Emit the property signals coalesced since the last main loop iteration.
+ */
+void luaA_emit_property_signals(void) {
+    luna_signal_emit_coalesced(globalconf_get_lua_State());
+}
+
+/** Emit the refresh signal. Property signals coalesced from its slots are
+ * emitted right after, followed by another refresh for what their slots
+ * delayed, as long as there are some.
+ */
 void luaA_emit_refresh(void) {
     lua_State *L = globalconf_get_lua_State();
     luna_emit_global_signal(L, "refresh", 0);
+    for (int i = 0; i < LUNA_SIGNAL_COALESCED_ROUNDS && luna_signal_emit_coalesced(L); i++)
+        luna_emit_global_signal(L, "refresh", 0);
 }
 
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
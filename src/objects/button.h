@@ -30,6 +30,7 @@
 
 /** Mouse buttons bindings */
 struct button_t {
+    LUNA_OBJECT_HEADER
     /** Key modifiers */
     uint16_t     modifiers;
     /** Mouse button number */
@@ -101,6 +101,7 @@
 #include "property.h"
 #include "spawn.h"
 #include "systray.h"
+#include "winreg.h"
 #include "xwindow.h"
 
 #include "math.h"
@@ -1532,6 +1533,11 @@ titlebar_get_drawable(lua_State *L, client_t *c, int cl_idx, client_titlebar_t b
 static void client_resize_do(client_t *c, area_t geometry);
 static void
 client_set_maximized_common(lua_State *L, int cidx, bool s, const char *type, const int val);
+static void client_dequeue_geometry_refresh(client_t *c);
+static void client_wipe_scaled_icons(client_t *c);
+
+/** Clients with pending geometry changes, walked by client_geometry_refresh() */
+static client_array_t client_geometry_dirty;
 
 static void lunaL_client_alloc(lua_State *L) {
     client_t *c = lua_newuserdatauv(L, sizeof(client_t), 1);
@@ -1543,9 +1549,13 @@ static void lunaL_client_alloc(lua_State *L) {
  */
 static void lunaL_client_gc(lua_State *L, void *p) {
     client_t *c = (client_t *)p;
+    client_dequeue_geometry_refresh(c);
     key_array_wipe(&c->keys);
+    bitset_wipe(&c->tags);
     xcb_icccm_get_wm_protocols_reply_wipe(&c->protocols);
     cairo_surface_array_wipe(&c->icons);
+    ewmh_icon_array_wipe(&c->ewmh_icons);
+    client_wipe_scaled_icons(c);
     p_delete(&c->machine);
     p_delete(&c->class);
     p_delete(&c->instance);
@@ -1567,7 +1577,7 @@ void client_set_urgent(lua_State *L, int cidx, bool urgent) {
     if (c->urgent != urgent) {
         c->urgent = urgent;
 
-        luna_object_emit_signal(L, cidx, ":property.urgent", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.urgent"), 0);
     }
 }
 
@@ -1576,7 +1586,7 @@ void client_set_urgent(lua_State *L, int cidx, bool urgent) {
         client_t *c = luaC_checkuclass(L, cidx, "Client");                              \
         if (c->prop != value) {                                                         \
             c->prop = value;                                                            \
-            luna_object_emit_signal(L, cidx, ":property." #prop, 0);                    \
+            luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property." #prop), 0);    \
         }                                                                               \
     }
 DO_CLIENT_SET_PROPERTY(group_window)
@@ -1586,16 +1596,16 @@ DO_CLIENT_SET_PROPERTY(pid)
 DO_CLIENT_SET_PROPERTY(skip_taskbar)
 #undef DO_CLIENT_SET_PROPERTY
 
-#define DO_CLIENT_SET_STRING_PROPERTY2(prop, signal)               \
-    void client_set_##prop(lua_State *L, int cidx, char *value) {  \
-        client_t *c = luaC_checkuclass(L, cidx, "Client");         \
-        if (A_STREQ(c->prop, value)) {                             \
-            p_delete(&value);                                      \
-            return;                                                \
-        }                                                          \
-        p_delete(&c->prop);                                        \
-        c->prop = value;                                           \
-        luna_object_emit_signal(L, cidx, ":property." #signal, 0); \
+#define DO_CLIENT_SET_STRING_PROPERTY2(prop, signal)                               \
+    void client_set_##prop(lua_State *L, int cidx, char *value) {                  \
+        client_t *c = luaC_checkuclass(L, cidx, "Client");                         \
+        if (A_STREQ(c->prop, value)) {                                             \
+            p_delete(&value);                                                      \
+            return;                                                                \
+        }                                                                          \
+        p_delete(&c->prop);                                                        \
+        c->prop = value;                                                           \
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property." #signal), 0); \
     }
 #define DO_CLIENT_SET_STRING_PROPERTY(prop) DO_CLIENT_SET_STRING_PROPERTY2(prop, prop)
 DO_CLIENT_SET_STRING_PROPERTY(name)
@@ -1609,12 +1619,12 @@ DO_CLIENT_SET_STRING_PROPERTY(machine)
 
 void client_emit_scanned(void) {
     lua_State *L = globalconf_get_lua_State();
-    luna_class_emit_signal(L, "Client", "scanned", 0);
+    luna_class_emit_signal_id(L, "Client", LUNA_SIGNAL("scanned"), 0);
 }
 
 void client_emit_scanning(void) {
     lua_State *L = globalconf_get_lua_State();
-    luna_class_emit_signal(L, "Client", "scanning", 0);
+    luna_class_emit_signal_id(L, "Client", LUNA_SIGNAL("scanning"), 0);
 }
 
 void client_set_motif_wm_hints(lua_State *L, int cidx, motif_wm_hints_t hints) {
@@ -1622,7 +1632,7 @@ void client_set_motif_wm_hints(lua_State *L, int cidx, motif_wm_hints_t hints) {
     if (memcmp(&c->motif_wm_hints, &hints, sizeof(c->motif_wm_hints)) == 0) return;
 
     memcpy(&c->motif_wm_hints, &hints, sizeof(c->motif_wm_hints));
-    luna_object_emit_signal(L, cidx, ":property.motif_wm_hints", 0);
+    luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.motif_wm_hints"), 0);
 }
 
 void client_find_transient_for(client_t *c) {
@@ -1655,9 +1665,9 @@ void client_set_class_instance(lua_State *L, int cidx, const char *class, const
     p_delete(&c->class);
     p_delete(&c->instance);
     c->class = a_strdup(class);
-    luna_object_emit_signal(L, cidx, ":property.class", 0);
+    luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.class"), 0);
     c->instance = a_strdup(instance);
-    luna_object_emit_signal(L, cidx, ":property.instance", 0);
+    luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.instance"), 0);
 }
 
 /** Returns true if a client is tagged with one of the active tags.
@@ -1667,10 +1677,7 @@ void client_set_class_instance(lua_State *L, int cidx, const char *class, const
 bool client_on_selected_tags(client_t *c) {
     if (c->sticky) return true;
 
-    foreach (tag, globalconf.tags)
-        if ((*tag)->selected && is_client_tagged(c, *tag)) return true;
-
-    return false;
+    return bitset_intersects(&c->tags, &globalconf.selected_tags);
 }
 
 /** Get a client by its window.
@@ -1678,17 +1685,15 @@ bool client_on_selected_tags(client_t *c) {
  * \return A client pointer if found, NULL otherwise.
  */
 client_t *client_getbywin(xcb_window_t w) {
-    foreach (c, globalconf.clients)
-        if ((*c)->window == w) return *c;
-
-    return NULL;
+    return winreg_lookup(w, WINREG_CLIENT);
 }
 
+/** Get a client by its nofocus window.
+ * \param w The client window to find.
+ * \return A client pointer if found, NULL otherwise.
+ */
 client_t *client_getbynofocuswin(xcb_window_t w) {
-    foreach (c, globalconf.clients)
-        if ((*c)->nofocus_window == w) return *c;
-
-    return NULL;
+    return winreg_lookup(w, WINREG_CLIENT_NOFOCUS);
 }
 
 /** Get a client by its frame window.
@@ -1696,10 +1701,7 @@ client_t *client_getbynofocuswin(xcb_window_t w) {
  * \return A client pointer if found, NULL otherwise.
  */
 client_t *client_getbyframewin(xcb_window_t w) {
-    foreach (c, globalconf.clients)
-        if ((*c)->frame_window == w) return *c;
-
-    return NULL;
+    return winreg_lookup(w, WINREG_CLIENT_FRAME);
 }
 
 /** Unfocus a client (internal).
@@ -1712,8 +1714,8 @@ static void client_unfocus_internal(client_t *c) {
     luna_object_push(L, c);
 
     lua_pushboolean(L, false);
-    luna_object_emit_signal(L, -2, ":property.active", 1);
-    luna_object_emit_signal(L, -1, "unfocus", 0);
+    luna_object_emit_signal_id(L, -2, LUNA_SIGNAL(":property.active"), 1);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL("unfocus"), 0);
     lua_pop(L, 1);
 }
 
@@ -1816,8 +1818,8 @@ bool client_focus_update(client_t *c) {
 
     if (focused_new) {
         lua_pushboolean(L, true);
-        luna_object_emit_signal(L, -2, ":property.active", 1);
-        luna_object_emit_signal(L, -1, "focus", 0);
+        luna_object_emit_signal_id(L, -2, LUNA_SIGNAL(":property.active"), 1);
+        luna_object_emit_signal_id(L, -1, LUNA_SIGNAL("focus"), 0);
     }
 
     lua_pop(L, 1);
@@ -1843,6 +1845,7 @@ static xcb_window_t client_get_nofocus_window(client_t *c) {
             -2, 1, 1, 0, XCB_COPY_FROM_PARENT, globalconf.visual->visual_id, 0, NULL);
         xcb_map_window(globalconf.connection, c->nofocus_window);
         xwindow_grabkeys(c->nofocus_window, &c->keys);
+        winreg_insert(c->nofocus_window, WINREG_CLIENT_NOFOCUS, c);
     }
     return c->nofocus_window;
 }
@@ -1874,15 +1877,37 @@ void client_focus_refresh(void) {
     globalconf.focus.need_update = false;
 }
 
-static void client_border_refresh(void) {
-    foreach (c, globalconf.clients)
-        window_border_refresh((window_t *)*c);
+/** Queue a client for the next geometry refresh.
+ * \param c The client.
+ */
+void client_queue_geometry_refresh(client_t *c) {
+    if (c->geometry_dirty) return;
+    c->geometry_dirty = true;
+    client_array_append(&client_geometry_dirty, c);
+}
+
+/** Drop a client from the geometry refresh queue.
+ * \param c The client.
+ */
+static void client_dequeue_geometry_refresh(client_t *c) {
+    if (!c->geometry_dirty) return;
+    c->geometry_dirty = false;
+    foreach (elem, client_geometry_dirty)
+        if (*elem == c) {
+            client_array_remove(&client_geometry_dirty, elem);
+            break;
+        }
 }
 
 static void client_geometry_refresh(void) {
     bool ignored_enterleave = false;
-    foreach (_c, globalconf.clients) {
-        client_t *c          = *_c;
+    foreach (_c, client_geometry_dirty) {
+        client_t *c       = *_c;
+        c->geometry_dirty = false;
+        globalconf.refresh_count.geometry++;
+
+        /* Unmanaged clients stay around until they are collected */
+        if (!c->window) continue;
 
         /* Compute the client window's and frame window's geometry */
         area_t geometry      = c->geometry;
@@ -1953,12 +1978,13 @@ static void client_geometry_refresh(void) {
         client_send_configure(c);
         c->got_configure_request = false;
     }
+    client_geometry_dirty.len = 0;
     if (ignored_enterleave) client_restore_enterleave_events();
 }
 
 void client_refresh(void) {
     client_geometry_refresh();
-    client_border_refresh();
+    window_border_refresh();
     client_focus_refresh();
 }
 
@@ -1988,70 +2014,124 @@ static void border_width_callback(client_t *c, uint16_t old_width, uint16_t new_
     }
 }
 
-static void client_update_properties(lua_State *L, int cidx, client_t *c) {
-    /* get all hints */
-    xcb_get_property_cookie_t wm_normal_hints   = property_get_wm_normal_hints(c);
-    xcb_get_property_cookie_t wm_hints          = property_get_wm_hints(c);
-    xcb_get_property_cookie_t wm_transient_for  = property_get_wm_transient_for(c);
-    xcb_get_property_cookie_t wm_client_leader  = property_get_wm_client_leader(c);
-    xcb_get_property_cookie_t wm_client_machine = property_get_wm_client_machine(c);
-    xcb_get_property_cookie_t wm_window_role    = property_get_wm_window_role(c);
-    xcb_get_property_cookie_t net_wm_pid        = property_get_net_wm_pid(c);
-    xcb_get_property_cookie_t net_wm_icon       = property_get_net_wm_icon(c);
-    xcb_get_property_cookie_t wm_name           = property_get_wm_name(c);
-    xcb_get_property_cookie_t net_wm_name       = property_get_net_wm_name(c);
-    xcb_get_property_cookie_t wm_icon_name      = property_get_wm_icon_name(c);
-    xcb_get_property_cookie_t net_wm_icon_name  = property_get_net_wm_icon_name(c);
-    xcb_get_property_cookie_t wm_class          = property_get_wm_class(c);
-    xcb_get_property_cookie_t wm_protocols      = property_get_wm_protocols(c);
-    xcb_get_property_cookie_t motif_wm_hints    = property_get_motif_wm_hints(c);
-    xcb_get_property_cookie_t opacity           = xwindow_get_opacity_unchecked(c->window);
-
+static void client_update_properties(
+    lua_State *L, int cidx, client_t *c, client_manage_cookies_t *cookies) {
     /* update strut */
-    ewmh_process_client_strut(c);
+    ewmh_process_client_strut(c, cookies->strut);
 
     /* Now process all replies */
-    property_update_wm_normal_hints(c, wm_normal_hints);
-    property_update_wm_hints(c, wm_hints);
-    property_update_wm_transient_for(c, wm_transient_for);
-    property_update_wm_client_leader(c, wm_client_leader);
-    property_update_wm_client_machine(c, wm_client_machine);
-    property_update_wm_window_role(c, wm_window_role);
-    property_update_net_wm_pid(c, net_wm_pid);
-    property_update_net_wm_icon(c, net_wm_icon);
-    property_update_wm_name(c, wm_name);
-    property_update_net_wm_name(c, net_wm_name);
-    property_update_wm_icon_name(c, wm_icon_name);
-    property_update_net_wm_icon_name(c, net_wm_icon_name);
-    property_update_wm_class(c, wm_class);
-    property_update_wm_protocols(c, wm_protocols);
-    property_update_motif_wm_hints(c, motif_wm_hints);
-    window_set_opacity(L, cidx, xwindow_get_opacity_from_cookie(opacity));
+    property_update_wm_normal_hints(c, cookies->wm_normal_hints);
+    property_update_wm_hints(c, cookies->wm_hints);
+    property_update_wm_transient_for(c, cookies->wm_transient_for);
+    property_update_wm_client_leader(c, cookies->wm_client_leader);
+    property_update_wm_client_machine(c, cookies->wm_client_machine);
+    property_update_wm_window_role(c, cookies->wm_window_role);
+    property_update_net_wm_pid(c, cookies->net_wm_pid);
+    property_update_net_wm_icon(c, cookies->net_wm_icon);
+    property_update_wm_name(c, cookies->wm_name);
+    property_update_net_wm_name(c, cookies->net_wm_name);
+    property_update_wm_icon_name(c, cookies->wm_icon_name);
+    property_update_net_wm_icon_name(c, cookies->net_wm_icon_name);
+    property_update_wm_class(c, cookies->wm_class);
+    property_update_wm_protocols(c, cookies->wm_protocols);
+    property_update_motif_wm_hints(c, cookies->motif_wm_hints);
+    window_set_opacity(L, cidx, xwindow_get_opacity_from_cookie(cookies->opacity));
+}
+
+/** Send all the requests client_manage() needs the replies to, without
+ * waiting for any of them.
+ * \param w The window.
+ * \param cookies Where to store the cookies.
+ */
+void client_manage_prefetch(xcb_window_t w, client_manage_cookies_t *cookies) {
+    cookies->kde_dockapp = systray_kdedockapp_get_unchecked(w);
+
+    /* If this is a new client that just has been launched, then request its
+     * startup id. */
+    cookies->startup_id  = xcb_get_property(
+        globalconf.connection, false, w, _NET_STARTUP_ID, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX);
+
+    /* get all hints */
+    cookies->strut             = ewmh_client_strut_get_unchecked(w);
+    cookies->wm_normal_hints   = property_get_wm_normal_hints(w);
+    cookies->wm_hints          = property_get_wm_hints(w);
+    cookies->wm_transient_for  = property_get_wm_transient_for(w);
+    cookies->wm_client_leader  = property_get_wm_client_leader(w);
+    cookies->wm_client_machine = property_get_wm_client_machine(w);
+    cookies->wm_window_role    = property_get_wm_window_role(w);
+    cookies->net_wm_pid        = property_get_net_wm_pid(w);
+    cookies->net_wm_icon       = property_get_net_wm_icon(w);
+    cookies->wm_name           = property_get_wm_name(w);
+    cookies->net_wm_name       = property_get_net_wm_name(w);
+    cookies->wm_icon_name      = property_get_wm_icon_name(w);
+    cookies->net_wm_icon_name  = property_get_net_wm_icon_name(w);
+    cookies->wm_class          = property_get_wm_class(w);
+    cookies->wm_protocols      = property_get_wm_protocols(w);
+    cookies->motif_wm_hints    = property_get_motif_wm_hints(w);
+    cookies->opacity           = xwindow_get_opacity_unchecked(w);
+    ewmh_client_hints_get_unchecked(w, &cookies->ewmh_hints);
+}
+
+/** Throw away the replies to the requests sent by client_manage_prefetch()
+ * that were not consumed yet, when the window will not be managed after all.
+ * \param cookies The cookies.
+ */
+void client_manage_discard(client_manage_cookies_t *cookies) {
+    xcb_get_property_cookie_t all[] = {
+        cookies->kde_dockapp,
+        cookies->startup_id,
+        cookies->strut,
+        cookies->wm_normal_hints,
+        cookies->wm_hints,
+        cookies->wm_transient_for,
+        cookies->wm_client_leader,
+        cookies->wm_client_machine,
+        cookies->wm_window_role,
+        cookies->net_wm_pid,
+        cookies->net_wm_icon,
+        cookies->wm_name,
+        cookies->net_wm_name,
+        cookies->wm_icon_name,
+        cookies->net_wm_icon_name,
+        cookies->wm_class,
+        cookies->wm_protocols,
+        cookies->motif_wm_hints,
+        cookies->opacity,
+        cookies->ewmh_hints.desktop,
+        cookies->ewmh_hints.state,
+        cookies->ewmh_hints.window_type,
+    };
+
+    for (int i = 0; i < countof(all); i++)
+        if (all[i].sequence) xcb_discard_reply(globalconf.connection, all[i].sequence);
 }
 
 /** Manage a new client.
+ * The reparenting is only checked by client_manage_check(), so that a batch of
+ * windows can be managed before waiting on the X server.
  * \param w The window.
  * \param wgeom Window geometry.
- * \param startup True if we are managing at startup time.
+ * \param wattr Window attributes.
+ * \param cookies Cookies from client_manage_prefetch().
  */
 void client_manage(
     xcb_window_t                       w,
     xcb_get_geometry_reply_t          *wgeom,
-    xcb_get_window_attributes_reply_t *wattr) {
-    xcb_void_cookie_t reparent_cookie;
-    lua_State        *L                  = globalconf_get_lua_State();
-    const uint32_t    select_input_val[] = {CLIENT_SELECT_INPUT_EVENT_MASK};
+    xcb_get_window_attributes_reply_t *wattr,
+    client_manage_cookies_t           *cookies) {
+    lua_State     *L                  = globalconf_get_lua_State();
+    const uint32_t select_input_val[] = {CLIENT_SELECT_INPUT_EVENT_MASK};
 
-    if (systray_iskdedockapp(w)) {
+    /* Nothing to reparent */
+    cookies->reparent.sequence        = 0;
+
+    if (systray_iskdedockapp(cookies->kde_dockapp)) {
+        cookies->kde_dockapp.sequence = 0;
+        client_manage_discard(cookies);
         systray_request_handle(w);
         return;
     }
 
-    /* If this is a new client that just has been launched, then request its
-     * startup id. */
-    xcb_get_property_cookie_t startup_id_q = xcb_get_property(
-        globalconf.connection, false, w, _NET_STARTUP_ID, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX);
-
     /* Make sure the window is automatically mapped if awesome exits or dies. */
     xcb_change_save_set(globalconf.connection, XCB_SET_MODE_INSERT, w);
     if (globalconf.have_shape) xcb_shape_select_input(globalconf.connection, w, 1);
@@ -2087,7 +2167,8 @@ void client_manage(
 
     xcb_change_window_attributes(
         globalconf.connection, globalconf.screen->root, XCB_CW_EVENT_MASK, no_event);
-    reparent_cookie = xcb_reparent_window_checked(globalconf.connection, w, c->frame_window, 0, 0);
+    cookies->reparent =
+        xcb_reparent_window_checked(globalconf.connection, w, c->frame_window, 0, 0);
     xcb_map_window(globalconf.connection, w);
     xcb_change_window_attributes(
         globalconf.connection, globalconf.screen->root, XCB_CW_EVENT_MASK, ROOT_WINDOW_EVENT_MASK);
@@ -2112,6 +2193,8 @@ void client_manage(
     /* Duplicate client and push it in client list */
     lua_pushvalue(L, -1);
     client_array_push(&globalconf.clients, luna_object_ref(L, -1));
+    winreg_insert(c->window, WINREG_CLIENT, c);
+    winreg_insert(c->frame_window, WINREG_CLIENT_FRAME, c);
 
     /* Set the right screen */
     screen_client_moveto(c, screen_getbycoord(wgeom->x, wgeom->y), false);
@@ -2123,23 +2206,39 @@ void client_manage(
     c->geometry.y      = wgeom->y;
     c->geometry.width  = wgeom->width;
     c->geometry.height = wgeom->height;
+    client_queue_geometry_refresh(c);
 
-    luna_object_emit_signal(L, -1, ":property.x", 0);
-    luna_object_emit_signal(L, -1, ":property.y", 0);
-    luna_object_emit_signal(L, -1, ":property.width", 0);
-    luna_object_emit_signal(L, -1, ":property.height", 0);
-    luna_object_emit_signal(L, -1, ":property.window", 0);
-    luna_object_emit_signal(L, -1, ":property.geometry", 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.x"), 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.y"), 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.width"), 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.height"), 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.window"), 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.geometry"), 0);
 
     /* Set border width */
     window_set_border_width(L, -1, wgeom->border_width);
 
     /* we honor size hints by default */
     c->size_hints_honor = true;
-    luna_object_emit_signal(L, -1, ":property.size_hints_honor", 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.size_hints_honor"), 0);
 
     /* update all properties */
-    client_update_properties(L, -1, c);
+    client_update_properties(L, -1, c, cookies);
+
+    /* Request our response */
+    xcb_get_property_reply_t *reply =
+        xcb_get_property_reply(globalconf.connection, cookies->startup_id, NULL);
+    /* Say spawn that a client has been started, with startup id as argument */
+    char *startup_id = xutil_get_text_property_from_reply(reply);
+    p_delete(&reply);
+
+    /* GTK hides this property elsewhere. No idea why. Ask for it now, but only
+     * wait for the reply once everything else has been done. */
+    xcb_get_property_cookie_t leader_startup_id_q = {0};
+    if (startup_id == NULL && c->leader_window != XCB_NONE)
+        leader_startup_id_q = xcb_get_property(
+            globalconf.connection, false, c->leader_window, _NET_STARTUP_ID,
+            XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX);
 
     /* check if this is a TRANSIENT_FOR of another client */
     foreach (oc, globalconf.clients)
@@ -2149,24 +2248,13 @@ void client_manage(
     xwindow_set_state(c->window, XCB_ICCCM_WM_STATE_NORMAL);
 
     /* Then check clients hints */
-    ewmh_client_check_hints(c);
+    ewmh_client_check_hints(c, &cookies->ewmh_hints);
 
     /* Push client in stack */
     stack_client_push(c);
 
-    /* Request our response */
-    xcb_get_property_reply_t *reply =
-        xcb_get_property_reply(globalconf.connection, startup_id_q, NULL);
-    /* Say spawn that a client has been started, with startup id as argument */
-    char *startup_id = xutil_get_text_property_from_reply(reply);
-    p_delete(&reply);
-
-    if (startup_id == NULL && c->leader_window != XCB_NONE) {
-        /* GTK hides this property elsewhere. No idea why. */
-        startup_id_q = xcb_get_property(
-            globalconf.connection, false, c->leader_window, _NET_STARTUP_ID,
-            XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX);
-        reply      = xcb_get_property_reply(globalconf.connection, startup_id_q, NULL);
+    if (leader_startup_id_q.sequence) {
+        reply      = xcb_get_property_reply(globalconf.connection, leader_startup_id_q, NULL);
         startup_id = xutil_get_text_property_from_reply(reply);
         p_delete(&reply);
     }
@@ -2174,7 +2262,7 @@ void client_manage(
 
     spawn_start_notify(c, startup_id);
 
-    luna_class_emit_signal(L, "Client", "list", 0);
+    luna_class_emit_signal_id(L, "Client", LUNA_SIGNAL("list"), 0);
 
     /* Add the context */
     if (globalconf.loop == NULL) lua_pushstring(L, "startup");
@@ -2184,24 +2272,35 @@ void client_manage(
     lua_newtable(L);
 
     /* client is still on top of the stack; emit signal */
-    luna_object_emit_signal(L, -3, ":request.manage", 2);
+    luna_object_emit_signal_id(L, -3, LUNA_SIGNAL(":request.manage"), 2);
 
     /*TODO v6: remove this*/
-    luna_object_emit_signal(L, -1, "manage", 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL("manage"), 0);
+
+    /* pop client */
+    lua_pop(L, 1);
+}
+
+/** Check that the reparenting done by client_manage() worked, and unmanage
+ * the client if it did not.
+ * \param w The window.
+ * \param cookies The cookies passed to client_manage().
+ */
+void client_manage_check(xcb_window_t w, client_manage_cookies_t *cookies) {
+    if (!cookies->reparent.sequence) return;
+
+    xcb_generic_error_t *error = xcb_request_check(globalconf.connection, cookies->reparent);
+    if (error == NULL) return;
 
-    xcb_generic_error_t *error = xcb_request_check(globalconf.connection, reparent_cookie);
-    if (error != NULL) {
+    client_t *c = client_getbywin(w);
+    if (c)
         warn(
             "Failed to manage window with name '%s', class '%s', instance '%s', because "
             "reparenting failed.",
             NONULL(c->name), NONULL(c->class), NONULL(c->instance));
-        event_handle((xcb_generic_event_t *)error);
-        p_delete(&error);
-        client_unmanage(c, CLIENT_UNMANAGE_FAILED);
-    }
-
-    /* pop client */
-    lua_pop(L, 1);
+    event_handle((xcb_generic_event_t *)error);
+    p_delete(&error);
+    if (c) client_unmanage(c, CLIENT_UNMANAGE_FAILED);
 }
 
 static void client_remove_titlebar_geometry(client_t *c, area_t *geometry) {
@@ -2348,21 +2447,24 @@ static void client_resize_do(client_t *c, area_t geometry) {
     /* Also store geometry including border */
     area_t old_geometry = c->geometry;
     c->geometry         = geometry;
+    client_queue_geometry_refresh(c);
 
     luna_object_push(L, c);
     if (!AREA_EQUAL(old_geometry, geometry))
-        luna_object_emit_signal(L, -1, ":property.geometry", 0);
+        luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.geometry"), 0);
     if (old_geometry.x != geometry.x || old_geometry.y != geometry.y) {
-        luna_object_emit_signal(L, -1, ":property.position", 0);
-        if (old_geometry.x != geometry.x) luna_object_emit_signal(L, -1, ":property.x", 0);
-        if (old_geometry.y != geometry.y) luna_object_emit_signal(L, -1, ":property.y", 0);
+        luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.position"), 0);
+        if (old_geometry.x != geometry.x)
+            luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.x"), 0);
+        if (old_geometry.y != geometry.y)
+            luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.y"), 0);
     }
     if (old_geometry.width != geometry.width || old_geometry.height != geometry.height) {
-        luna_object_emit_signal(L, -1, ":property.size", 0);
+        luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.size"), 0);
         if (old_geometry.width != geometry.width)
-            luna_object_emit_signal(L, -1, ":property.width", 0);
+            luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.width"), 0);
         if (old_geometry.height != geometry.height)
-            luna_object_emit_signal(L, -1, ":property.height", 0);
+            luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.height"), 0);
     }
     lua_pop(L, 1);
 
@@ -2470,7 +2572,7 @@ void client_set_minimized(lua_State *L, int cidx, bool s) {
             xcb_map_window(globalconf.connection, c->window);
         }
         if (strut_has_value(&c->strut)) screen_update_workarea(c->screen);
-        luna_object_emit_signal(L, cidx, ":property.minimized", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.minimized"), 0);
     }
 }
 
@@ -2486,7 +2588,7 @@ static void client_set_hidden(lua_State *L, int cidx, bool s) {
         c->hidden = s;
         banning_need_update();
         if (strut_has_value(&c->strut)) screen_update_workarea(c->screen);
-        luna_object_emit_signal(L, cidx, ":property.hidden", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.hidden"), 0);
     }
 }
 
@@ -2503,7 +2605,7 @@ void client_set_sticky(lua_State *L, int cidx, bool s) {
         banning_need_update();
         ewmh_client_update_desktop(c);
         if (strut_has_value(&c->strut)) screen_update_workarea(c->screen);
-        luna_object_emit_signal(L, cidx, ":property.sticky", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.sticky"), 0);
     }
 }
 
@@ -2518,7 +2620,7 @@ static void client_set_focusable(lua_State *L, int cidx, bool s) {
     if (c->focusable != s || !c->focusable_set) {
         c->focusable     = s;
         c->focusable_set = true;
-        luna_object_emit_signal(L, cidx, ":property.focusable", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.focusable"), 0);
     }
 }
 
@@ -2531,7 +2633,7 @@ static void client_unset_focusable(lua_State *L, int cidx) {
 
     if (c->focusable_set) {
         c->focusable_set = false;
-        luna_object_emit_signal(L, cidx, ":property.focusable", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.focusable"), 0);
     }
 }
 
@@ -2554,8 +2656,8 @@ void client_set_fullscreen(lua_State *L, int cidx, bool s) {
         int abs_cidx = luaA_absindex(L, cidx);
         lua_pushstring(L, "fullscreen");
         c->fullscreen = s;
-        luna_object_emit_signal(L, abs_cidx, ":request.geometry", 1);
-        luna_object_emit_signal(L, abs_cidx, ":property.fullscreen", 0);
+        luna_object_emit_signal_id(L, abs_cidx, LUNA_SIGNAL(":request.geometry"), 1);
+        luna_object_emit_signal_id(L, abs_cidx, LUNA_SIGNAL(":property.fullscreen"), 0);
         /* Force a client resize, so that titlebars get shown/hidden */
         client_resize_do(c, c->geometry);
         stack_windows();
@@ -2594,15 +2696,16 @@ void client_set_maximized_common(lua_State *L, int cidx, bool s, const char *typ
 
         /* Request the changes to be applied */
         lua_pushstring(L, type);
-        luna_object_emit_signal(L, abs_cidx, ":request.geometry", 1);
+        luna_object_emit_signal_id(L, abs_cidx, LUNA_SIGNAL(":request.geometry"), 1);
 
         /* Notify changes in the relevant properties */
         if (h_before != c->maximized_horizontal)
-            luna_object_emit_signal(L, abs_cidx, ":property.maximized_horizontal", 0);
+            luna_object_emit_signal_id(
+                L, abs_cidx, LUNA_SIGNAL(":property.maximized_horizontal"), 0);
         if (v_before != c->maximized_vertical)
-            luna_object_emit_signal(L, abs_cidx, ":property.maximized_vertical", 0);
+            luna_object_emit_signal_id(L, abs_cidx, LUNA_SIGNAL(":property.maximized_vertical"), 0);
         if (max_before != c->maximized)
-            luna_object_emit_signal(L, abs_cidx, ":property.maximized", 0);
+            luna_object_emit_signal_id(L, abs_cidx, LUNA_SIGNAL(":property.maximized"), 0);
 
         stack_windows();
     }
@@ -2637,7 +2740,7 @@ void client_set_above(lua_State *L, int cidx, bool s) {
         }
         c->above = s;
         stack_windows();
-        luna_object_emit_signal(L, cidx, ":property.above", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.above"), 0);
     }
 }
 
@@ -2658,7 +2761,7 @@ void client_set_below(lua_State *L, int cidx, bool s) {
         }
         c->below = s;
         stack_windows();
-        luna_object_emit_signal(L, cidx, ":property.below", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.below"), 0);
     }
 }
 
@@ -2673,7 +2776,7 @@ void client_set_modal(lua_State *L, int cidx, bool s) {
     if (c->modal != s) {
         c->modal = s;
         stack_windows();
-        luna_object_emit_signal(L, cidx, ":property.modal", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.modal"), 0);
     }
 }
 
@@ -2694,7 +2797,7 @@ void client_set_ontop(lua_State *L, int cidx, bool s) {
         }
         c->ontop = s;
         stack_windows();
-        luna_object_emit_signal(L, cidx, ":property.ontop", 0);
+        luna_object_emit_signal_id(L, cidx, LUNA_SIGNAL(":property.ontop"), 0);
     }
 }
 
@@ -2741,6 +2844,10 @@ void client_unmanage(client_t *c, client_unmanage_t reason) {
             client_array_remove(&globalconf.clients, elem);
             break;
         }
+    winreg_remove(c->window);
+    winreg_remove(c->frame_window);
+    winreg_remove(c->nofocus_window);
+    client_dequeue_geometry_refresh(c);
     stack_client_remove(c);
     for (int i = 0; i < globalconf.tags.len; i++)
         untag_client(c, globalconf.tags.tab[i]);
@@ -2766,11 +2873,11 @@ void client_unmanage(client_t *c, client_unmanage_t reason) {
     /* Hints */
     lua_newtable(L);
 
-    luna_object_emit_signal(L, -3, ":request.unmanage", 2);
-    luna_object_emit_signal(L, -1, "unmanage", 0);
+    luna_object_emit_signal_id(L, -3, LUNA_SIGNAL(":request.unmanage"), 2);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL("unmanage"), 0);
     lua_pop(L, 1);
 
-    luna_class_emit_signal(L, "Client", "list", 0);
+    luna_class_emit_signal_id(L, "Client", LUNA_SIGNAL("list"), 0);
 
     if (strut_has_value(&c->strut)) screen_update_workarea(c->screen);
 
@@ -2825,6 +2932,11 @@ void client_unmanage(client_t *c, client_unmanage_t reason) {
     /* set client as invalid */
     c->window = XCB_NONE;
 
+    /* Its property changes are not interesting anymore */
+    luna_object_push(L, c);
+    luna_object_drop_coalesced_signals(L, -1);
+    lua_pop(L, 1);
+
     luna_object_unref(L, c);
 }
 
@@ -2899,19 +3011,160 @@ static int luaA_client_isvisible(lua_State *L) {
     return 1;
 }
 
+static void client_wipe_scaled_icons(client_t *c) {
+    for (int i = 0; i < CLIENT_SCALED_ICONS; i++)
+        if (c->scaled_icons[i].surface) cairo_surface_destroy(c->scaled_icons[i].surface);
+    p_clear(c->scaled_icons, CLIENT_SCALED_ICONS);
+    c->scaled_icons_next = 0;
+}
+
+static void client_replace_icons(client_t *c, cairo_surface_array_t array, bool pending) {
+    client_wipe_scaled_icons(c);
+    cairo_surface_array_wipe(&c->icons);
+    ewmh_icon_array_wipe(&c->ewmh_icons);
+    ewmh_icon_array_init(&c->ewmh_icons);
+    c->icons              = array;
+    c->ewmh_icons_pending = pending;
+
+    lua_State *L          = globalconf_get_lua_State();
+    luna_object_push(L, c);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.icon"), 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.icon_sizes"), 0);
+    lua_pop(L, 1);
+}
+
 /** Set client icons.
  * \param L The Lua VM state.
  * \param array Array of icons to set.
  */
 void client_set_icons(client_t *c, cairo_surface_array_t array) {
-    cairo_surface_array_wipe(&c->icons);
-    c->icons     = array;
+    client_replace_icons(c, array, false);
+}
 
-    lua_State *L = globalconf_get_lua_State();
-    luna_object_push(L, c);
-    luna_object_emit_signal(L, -1, ":property.icon", 0);
-    luna_object_emit_signal(L, -1, ":property.icon_sizes", 0);
-    lua_pop(L, 1);
+/** Drop the client icons because _NET_WM_ICON changed. It is only read again
+ * once the icons are asked for.
+ * \param c The client.
+ */
+void client_invalidate_ewmh_icons(client_t *c) {
+    cairo_surface_array_t array;
+    cairo_surface_array_init(&array);
+    client_replace_icons(c, array, true);
+}
+
+/** Read the sizes of the images of _NET_WM_ICON if it changed since they were
+ * last needed. The images themselves are read by client_get_icon().
+ * \param c The client.
+ */
+static void client_load_icons(client_t *c) {
+    /* An unmanaged client has no window to read from anymore */
+    if (!c->ewmh_icons_pending || !c->window) return;
+    c->ewmh_icons_pending = false;
+
+    c->ewmh_icons         = ewmh_window_icon_get_headers(c->window);
+    for (int i = 0; i < c->ewmh_icons.len; i++)
+        cairo_surface_array_append(&c->icons, NULL);
+}
+
+/** Get the size of a client icon without reading its image.
+ * \param c The client.
+ * \param i The index of the icon.
+ * \param width Where to store the width.
+ * \param height Where to store the height.
+ */
+static void client_get_icon_size(client_t *c, int i, int *width, int *height) {
+    if (i < c->ewmh_icons.len) {
+        *width  = c->ewmh_icons.tab[i].width;
+        *height = c->ewmh_icons.tab[i].height;
+    } else {
+        *width  = cairo_image_surface_get_width(c->icons.tab[i]);
+        *height = cairo_image_surface_get_height(c->icons.tab[i]);
+    }
+}
+
+/** Get a client icon, reading it from _NET_WM_ICON if needed.
+ * \param c The client.
+ * \param i The index of the icon.
+ * \return The icon, or NULL if it could not be read.
+ */
+static cairo_surface_t *client_get_icon(client_t *c, int i) {
+    if (!c->icons.tab[i] && i < c->ewmh_icons.len && c->window)
+        c->icons.tab[i] = ewmh_window_icon_get_image(c->window, &c->ewmh_icons.tab[i]);
+    return c->icons.tab[i];
+}
+
+/** Find the icon to scale for a size: the smallest one at least as big, or the
+ * biggest one if none is.
+ * \param c The client.
+ * \param width The width to fit in.
+ * \param height The height to fit in.
+ * \return The index of the icon, or -1 if there is none.
+ */
+static int client_find_icon(client_t *c, int width, int height) {
+    int best = -1, best_width = 0, best_height = 0;
+
+    for (int i = 0; i < c->icons.len; i++) {
+        int w, h;
+        client_get_icon_size(c, i, &w, &h);
+
+        bool best_too_small         = best_width < width || best_height < height;
+        bool best_too_large         = best_width > width || best_height > height;
+        bool better_because_bigger  = best_too_small && w > best_width && h > best_height;
+        bool better_because_smaller = best_too_large && w < best_width && h < best_height &&
+                                      w >= width && h >= height;
+        if (best < 0 || better_because_bigger || better_because_smaller) {
+            best        = i;
+            best_width  = w;
+            best_height = h;
+        }
+    }
+
+    return best;
+}
+
+/** Get a client icon scaled to fit a size, keeping its aspect ratio. The
+ * result is cached until the icons change.
+ * \param c The client.
+ * \param width The width to fit in.
+ * \param height The height to fit in.
+ * \return The scaled icon, or NULL if there is none.
+ */
+static cairo_surface_t *client_get_scaled_icon(client_t *c, int width, int height) {
+    client_scaled_icon_t *entry;
+    cairo_surface_t      *icon, *scaled;
+    cairo_t              *cr;
+    int                   index;
+    double                aspect;
+
+    for (int i = 0; i < CLIENT_SCALED_ICONS; i++) {
+        entry = &c->scaled_icons[i];
+        if (entry->width == width && entry->height == height) return entry->surface;
+    }
+
+    client_load_icons(c);
+    if ((index = client_find_icon(c, width, height)) < 0) return NULL;
+    if (!(icon = client_get_icon(c, index))) return NULL;
+
+    aspect = MIN(
+        (double)width / cairo_image_surface_get_width(icon),
+        (double)height / cairo_image_surface_get_height(icon));
+    scaled = cairo_image_surface_create(
+        CAIRO_FORMAT_ARGB32, MAX(1, round(cairo_image_surface_get_width(icon) * aspect)),
+        MAX(1, round(cairo_image_surface_get_height(icon) * aspect)));
+    cr = cairo_create(scaled);
+    cairo_scale(cr, aspect, aspect);
+    cairo_set_source_surface(cr, icon, 0, 0);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+
+    /* Replace the oldest entry */
+    entry = &c->scaled_icons[c->scaled_icons_next];
+    if (entry->surface) cairo_surface_destroy(entry->surface);
+    entry->width         = width;
+    entry->height        = height;
+    entry->surface       = scaled;
+    c->scaled_icons_next = (c->scaled_icons_next + 1) % CLIENT_SCALED_ICONS;
+
+    return scaled;
 }
 
 /** Set a client icon.
@@ -3042,16 +3295,16 @@ static int luaA_client_swap(lua_State *L) {
         *ref_c    = swap;
         *ref_swap = c;
 
-        luna_class_emit_signal(L, "Client", "list", 0);
+        luna_class_emit_signal_id(L, "Client", LUNA_SIGNAL("list"), 0);
 
         luna_object_push(L, swap);
         lua_pushboolean(L, true);
-        luna_object_emit_signal(L, -4, "swapped", 2);
+        luna_object_emit_signal_id(L, -4, LUNA_SIGNAL("swapped"), 2);
 
         luna_object_push(L, swap);
         luna_object_push(L, c);
         lua_pushboolean(L, false);
-        luna_object_emit_signal(L, -3, "swapped", 2);
+        luna_object_emit_signal_id(L, -3, LUNA_SIGNAL("swapped"), 2);
     }
 
     return 0;
@@ -3100,7 +3353,7 @@ static int luaA_client_tags(lua_State *L) {
 
         lua_pop(L, 1);
 
-        luna_object_emit_signal(L, -1, ":property.tags", 0);
+        luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.tags"), 0);
     }
 
     lua_newtable(L);
@@ -3160,7 +3413,7 @@ static int luaA_client_lower(lua_State *L) {
 
     /* Notify the listeners */
     luna_object_push(L, c);
-    luna_object_emit_signal(L, -1, "lowered", 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL("lowered"), 0);
     lua_pop(L, 1);
 
     return 0;
@@ -3258,10 +3511,11 @@ static void client_refresh_titlebar_partial(
         x - area.x, y - area.y, x, y, width, height);
 }
 
-#define HANDLE_TITLEBAR_REFRESH(name, index)                                                \
-    static void client_refresh_titlebar_##name(client_t *c) {                               \
-        area_t area = titlebar_get_area(c, index);                                          \
-        client_refresh_titlebar_partial(c, index, area.x, area.y, area.width, area.height); \
+#define HANDLE_TITLEBAR_REFRESH(name, index)                                      \
+    static void client_refresh_titlebar_##name(client_t *c, area_t part) {        \
+        area_t area = titlebar_get_area(c, index);                                \
+        client_refresh_titlebar_partial(                                          \
+            c, index, area.x + part.x, area.y + part.y, part.width, part.height); \
     }
 HANDLE_TITLEBAR_REFRESH(top, CLIENT_TITLEBAR_TOP)
 HANDLE_TITLEBAR_REFRESH(right, CLIENT_TITLEBAR_RIGHT)
@@ -3464,7 +3718,7 @@ static int luaA_client_keys(lua_State *L) {
 
     if (lua_gettop(L) == 2) {
         luaA_key_array_set(L, 1, 2, keys);
-        luna_object_emit_signal(L, 1, ":property.keys", 0);
+        luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.keys"), 0);
         xwindow_grabkeys(c->window, keys);
         if (c->nofocus_window) xwindow_grabkeys(c->nofocus_window, &c->keys);
     }
@@ -3497,8 +3751,36 @@ static int luaA_client_keys(lua_State *L) {
 static int luaA_client_get_some_icon(lua_State *L) {
     client_t *c     = luaC_checkuclass(L, 1, "Client");
     int       index = luaL_checkinteger(L, 2);
+    client_load_icons(c);
     luaL_argcheck(L, (index >= 1 && index <= c->icons.len), 2, "invalid icon index");
-    lua_pushlightuserdata(L, cairo_surface_reference(c->icons.tab[index - 1]));
+    cairo_surface_t *surf = client_get_icon(c, index - 1);
+    if (!surf) return 0;
+    lua_pushlightuserdata(L, cairo_surface_reference(surf));
+    return 1;
+}
+
+/** Get the client icon scaled to fit a size.
+ *
+ * The icon closest to the size is picked and scaled down or up to fit in it,
+ * keeping its aspect ratio. The result is kept until the icons change, so
+ * that widgets drawing the icon at the same size again do not need to scale
+ * it every time.
+ *
+ * @tparam integer width The width to fit in.
+ * @tparam integer height The height to fit in.
+ * @treturn surface A lightuserdata for a cairo surface, or nil if the client
+ * has no icon. This reference must be destroyed!
+ * @method get_scaled_icon
+ * @see get_icon
+ * @see awful.widget.clienticon
+ */
+static int luaA_client_get_scaled_icon(lua_State *L) {
+    client_t        *c      = luaC_checkuclass(L, 1, "Client");
+    int              width  = luaA_checkinteger_range(L, 2, 1, UINT16_MAX);
+    int              height = luaA_checkinteger_range(L, 3, 1, UINT16_MAX);
+    cairo_surface_t *surf   = client_get_scaled_icon(c, width, height);
+    if (!surf) return 0;
+    lua_pushlightuserdata(L, cairo_surface_reference(surf));
     return 1;
 }
 
@@ -3687,21 +3969,25 @@ lunaL_getter(client, group_window) {
 }
 
 lunaL_getter(client, icon_sizes) {
-    client_t *c     = luaC_checkuclass(L, 1, "Client");
-    int       index = 1;
+    client_t *c = luaC_checkuclass(L, 1, "Client");
+    int       width, height;
+
+    client_load_icons(c);
 
     lua_newtable(L);
-    foreach (s, c->icons) {
+    for (int i = 0; i < c->icons.len; i++) {
+        client_get_icon_size(c, i, &width, &height);
+
         /* Create a table { width, height } and append it to the table */
         lua_createtable(L, 2, 0);
 
-        lua_pushinteger(L, cairo_image_surface_get_width(*s));
+        lua_pushinteger(L, width);
         lua_rawseti(L, -2, 1);
 
-        lua_pushinteger(L, cairo_image_surface_get_height(*s));
+        lua_pushinteger(L, height);
         lua_rawseti(L, -2, 2);
 
-        lua_rawseti(L, -2, index++);
+        lua_rawseti(L, -2, i + 1);
     }
     return 1;
 }
@@ -3948,18 +4234,20 @@ lunaL_setter(client, maximized_vertical) {
 
 lunaL_getter(client, icon) {
     client_t *c = luaC_checkuclass(L, 1, "Client");
+    client_load_icons(c);
     if (c->icons.len == 0) return 0;
 
     /* Pick the closest available size, only picking a smaller icon if no bigger
-     * one is available.
+     * one is available. Only the picked image gets read from _NET_WM_ICON.
      */
-    cairo_surface_t *found          = NULL;
+    cairo_surface_t *found;
+    int              found_index    = -1;
     int              found_size     = 0;
     int              preferred_size = globalconf.preferred_icon_size;
 
-    foreach (surf, c->icons) {
-        int width                  = cairo_image_surface_get_width(*surf);
-        int height                 = cairo_image_surface_get_height(*surf);
+    for (int i = 0; i < c->icons.len; i++) {
+        int width, height;
+        client_get_icon_size(c, i, &width, &height);
         int size                   = MAX(width, height);
 
         /* pick the icon if it's a better match than the one we already have */
@@ -3970,11 +4258,13 @@ lunaL_getter(client, icon) {
         bool better_because_smaller =
             found_icon_too_large && size >= preferred_size && size < found_size;
         if (!icon_empty && (better_because_bigger || better_because_smaller || found_size == 0)) {
-            found      = *surf;
-            found_size = size;
+            found_index = i;
+            found_size  = size;
         }
     }
 
+    if (found_index < 0 || !(found = client_get_icon(c, found_index))) return 0;
+
     /* lua gets its own reference which it will have to destroy */
     lua_pushlightuserdata(L, cairo_surface_reference(found));
     return 1;
@@ -4041,7 +4331,7 @@ lunaL_getter(client, size_hints_honor) {
 lunaL_setter(client, size_hints_honor) {
     client_t *c         = luaC_checkuclass(L, 1, "Client");
     c->size_hints_honor = luaA_checkboolean(L, 2);
-    luna_object_emit_signal(L, 1, ":property.size_hints_honor", 0);
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.size_hints_honor"), 0);
     return 0;
 }
 
@@ -4092,7 +4382,7 @@ lunaL_setter(client, shape_bounding) {
     xwindow_set_shape(
         c->frame_window, c->geometry.width + (c->border_width * 2),
         c->geometry.height + (c->border_width * 2), XCB_SHAPE_SK_BOUNDING, surf, -c->border_width);
-    luna_object_emit_signal(L, 1, ":property.shape_bounding", 0);
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.shape_bounding"), 0);
     return 0;
 }
 
@@ -4111,7 +4401,7 @@ lunaL_setter(client, shape_clip) {
     if (!lua_isnil(L, 2)) surf = (cairo_surface_t *)lua_touserdata(L, 2);
     xwindow_set_shape(
         c->frame_window, c->geometry.width, c->geometry.height, XCB_SHAPE_SK_CLIP, surf, 0);
-    luna_object_emit_signal(L, 1, ":property.shape_clip", 0);
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.shape_clip"), 0);
     return 0;
 }
 
@@ -4131,7 +4421,7 @@ lunaL_setter(client, shape_input) {
     xwindow_set_shape(
         c->frame_window, c->geometry.width + (c->border_width * 2),
         c->geometry.height + (c->border_width * 2), XCB_SHAPE_SK_INPUT, surf, -c->border_width);
-    luna_object_emit_signal(L, 1, ":property.shape_input", 0);
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.shape_input"), 0);
     return 0;
 }
 
@@ -4176,6 +4466,7 @@ static luaL_Reg client_methods[] = {
     {"titlebar_bottom",  luaA_client_titlebar_bottom },
     {"titlebar_left",    luaA_client_titlebar_left   },
     {"get_icon",         luaA_client_get_some_icon   },
+    {"get_scaled_icon",  luaA_client_get_scaled_icon },
     {NULL,               NULL                        }
 };
 
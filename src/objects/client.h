@@ -23,8 +23,10 @@
 #ifndef AWESOME_OBJECTS_CLIENT_H
 #define AWESOME_OBJECTS_CLIENT_H
 
+#include "common/bitset.h"
 #include "common/object.h"
 #include "draw.h"
+#include "ewmh.h"
 #include "objects/window.h"
 #include "stack.h"
 
@@ -95,6 +97,43 @@ typedef struct {
     uint32_t status;
 } motif_wm_hints_t;
 
+/** Number of scaled icons kept per client */
+#define CLIENT_SCALED_ICONS 4
+
+/** A client icon scaled to fit a size */
+typedef struct {
+    /** The size the icon was asked for, 0 for an unused entry */
+    int              width, height;
+    cairo_surface_t *surface;
+} client_scaled_icon_t;
+
+/** Requests sent by client_manage_prefetch() so that managing many windows
+ * only waits on the X server once instead of several times per window */
+typedef struct {
+    xcb_get_property_cookie_t kde_dockapp;
+    xcb_get_property_cookie_t startup_id;
+    xcb_get_property_cookie_t strut;
+    xcb_get_property_cookie_t wm_normal_hints;
+    xcb_get_property_cookie_t wm_hints;
+    xcb_get_property_cookie_t wm_transient_for;
+    xcb_get_property_cookie_t wm_client_leader;
+    xcb_get_property_cookie_t wm_client_machine;
+    xcb_get_property_cookie_t wm_window_role;
+    xcb_get_property_cookie_t net_wm_pid;
+    xcb_get_property_cookie_t net_wm_icon;
+    xcb_get_property_cookie_t wm_name;
+    xcb_get_property_cookie_t net_wm_name;
+    xcb_get_property_cookie_t wm_icon_name;
+    xcb_get_property_cookie_t net_wm_icon_name;
+    xcb_get_property_cookie_t wm_class;
+    xcb_get_property_cookie_t wm_protocols;
+    xcb_get_property_cookie_t motif_wm_hints;
+    xcb_get_property_cookie_t opacity;
+    ewmh_hints_cookies_t      ewmh_hints;
+    /** Filled in by client_manage(), checked by client_manage_check() */
+    xcb_void_cookie_t         reparent;
+} client_manage_cookies_t;
+
 /** client_t type */
 struct client_t {
     WINDOW_OBJECT_HEADER
@@ -113,6 +152,8 @@ struct client_t {
     area_t                             x11_frame_geometry;
     /** Got a configure request and have to call client_send_configure() if its ignored? */
     bool                               got_configure_request;
+    /** Is the client queued for the next geometry refresh? */
+    bool                               geometry_dirty;
     /** Startup ID */
     char                              *startup_id;
     /** True if the client is sticky */
@@ -145,6 +186,8 @@ struct client_t {
      * Note that the geometry remains unchanged and that the window is still mapped.
      */
     bool                               isbanned;
+    /** Tags of the client, indexed by tag_t.bit */
+    bitset_t                           tags;
     /** true if the client must be skipped from task bar client list */
     bool                               skip_taskbar;
     /** True if the client cannot have focus */
@@ -163,10 +206,19 @@ struct client_t {
     xcb_icccm_get_wm_protocols_reply_t protocols;
     /** Key bindings */
     key_array_t                        keys;
-    /** Icons */
+    /** Icons, NULL for images of _NET_WM_ICON that were not read yet */
     cairo_surface_array_t              icons;
+    /** Where the images of _NET_WM_ICON are, one per entry of icons */
+    ewmh_icon_array_t                  ewmh_icons;
+    /** True if _NET_WM_ICON changed since ewmh_icons were read */
+    bool                               ewmh_icons_pending;
     /** True if we ever got an icon from _NET_WM_ICON */
     bool                               have_ewmh_icon;
+    /** Icons scaled for the sizes they were last asked for, dropped whenever
+     * the icons change */
+    client_scaled_icon_t               scaled_icons[CLIENT_SCALED_ICONS];
+    /** The entry of scaled_icons to replace next */
+    int                                scaled_icons_next;
     /** Size hints */
     xcb_size_hints_t                   size_hints;
     /** The visualtype that c->window uses */
@@ -183,6 +235,19 @@ struct client_t {
     client_t                          *transient_for;
     /** Value of WM_TRANSIENT_FOR */
     xcb_window_t                       transient_for_window;
+    /** Stacking links, rebuilt by stack_refresh() */
+    struct {
+        /** Refresh these links were built in */
+        unsigned int generation;
+        /** Next client in the same layer */
+        client_t    *next;
+        /** Clients transient for this one, in stacking order */
+        client_t    *transients, *transients_last;
+        /** Next client transient for the same parent */
+        client_t    *sibling;
+        /** Last position in the stacking order */
+        int          position;
+    } stacking;
     /** Titelbar information */
     struct {
         /** The size of this bar. */
@@ -206,8 +271,14 @@ client_t *client_getbyframewin(xcb_window_t);
 void client_ban(client_t *);
 void client_ban_unfocus(client_t *);
 void client_unban(client_t *);
-void client_manage(xcb_window_t, xcb_get_geometry_reply_t *, xcb_get_window_attributes_reply_t *);
+void client_manage_prefetch(xcb_window_t, client_manage_cookies_t *);
+void client_manage_discard(client_manage_cookies_t *);
+void client_manage(
+    xcb_window_t, xcb_get_geometry_reply_t *, xcb_get_window_attributes_reply_t *,
+    client_manage_cookies_t *);
+void client_manage_check(xcb_window_t, client_manage_cookies_t *);
 bool client_resize(client_t *, area_t, bool);
+void client_queue_geometry_refresh(client_t *);
 void client_unmanage(client_t *, client_unmanage_t);
 void client_kill(client_t *);
 void client_set_sticky(lua_State *, int, bool);
@@ -234,6 +305,7 @@ void client_set_startup_id(lua_State *L, int, char *);
 void client_set_alt_name(lua_State *L, int, char *);
 void client_set_group_window(lua_State *, int, xcb_window_t);
 void client_set_icons(client_t *, cairo_surface_array_t);
+void client_invalidate_ewmh_icons(client_t *);
 void client_set_icon_from_pixmaps(client_t *, xcb_pixmap_t, xcb_pixmap_t);
 void client_set_skip_taskbar(lua_State *, int, bool);
 void client_set_motif_wm_hints(lua_State *, int, motif_wm_hints_t);
@@ -253,32 +325,27 @@ area_t      client_get_undecorated_geometry(client_t *);
 
 void luaC_register_client(lua_State *);
 
-/** Put client on top of the stack.
+/** Put a client on top of the stack, after the clients it is transient for.
  * \param c The client to raise.
  */
-static inline void client_raise(client_t *c) {
-    client_t *tc      = c;
-    int       counter = 0;
+static inline void client_raise_transient_chain(client_t *c) {
+    if (!c) return;
 
-    /* Find number of transient layers. */
-    for (counter = 0; tc->transient_for; counter++)
-        tc = tc->transient_for;
-
-    /* Push them in reverse order. */
-    for (; counter > 0; counter--) {
-        tc = c;
-        for (int i = 0; i < counter; i++)
-            tc = tc->transient_for;
-        stack_client_append(tc);
-    }
-
-    /* Push c on top of the stack. */
+    /* Outermost parent first so c ends up on top. */
+    client_raise_transient_chain(c->transient_for);
     stack_client_append(c);
+}
+
+/** Put client on top of the stack.
+ * \param c The client to raise.
+ */
+static inline void client_raise(client_t *c) {
+    client_raise_transient_chain(c);
 
     /* Notify the listeners */
     lua_State *L = globalconf_get_lua_State();
     luna_object_push(L, c);
-    luna_object_emit_signal(L, -1, "raised", 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL("raised"), 0);
     lua_pop(L, 1);
 }
 
@@ -34,6 +34,35 @@
 #include "luaa.h"
 
 #include <cairo-xcb.h>
+#include <sys/shm.h>
+
+/** Pixmaps are created in multiples of this size, so that they fit for
+ * small resizes. */
+#define DRAWABLE_POOL_GRANULARITY 32
+/** Default memory limit of the pixmap pool in bytes. */
+#define DRAWABLE_POOL_LIMIT       (16 * 1024 * 1024)
+
+/** A pixmap which is not used by any drawable right now. */
+typedef struct drawable_pool_entry_t {
+    xcb_pixmap_t                 pixmap;
+    uint16_t                     width;
+    uint16_t                     height;
+    xcb_shm_seg_t                shm_seg;
+    void                        *shm_data;
+    /** Fence of the last upload from the segment, see drawable_shm_fence() */
+    xcb_get_input_focus_cookie_t shm_fence;
+} drawable_pool_entry_t;
+
+DO_ARRAY(drawable_pool_entry_t, drawable_pool_entry, DO_NOTHING)
+
+/** Pixmaps of resized and deleted drawables, oldest first. */
+static struct {
+    drawable_pool_entry_array_t entries;
+    size_t                      bytes;
+    size_t                      limit;
+    unsigned int                hits;
+    unsigned int                misses;
+} drawable_pool = {.limit = DRAWABLE_POOL_LIMIT};
 
 /** Drawable object.
  *
@@ -42,6 +71,32 @@
  * @propertydefault Autogenerated.
  */
 
+/**
+ * Draw into shared memory instead of a pixmap on the X server.
+ *
+ * Drawing then happens locally and only the refreshed areas are handed to the
+ * X server through a MIT-SHM segment. Changing it replaces the `surface`.
+ * Reading it tells whether the current surface really is in shared memory,
+ * which is not the case when the X server does not support MIT-SHM.
+ *
+ * @property shm
+ * @tparam[opt=false] boolean shm
+ * @propertydefault The value given to `awesome.set_drawable_shm`.
+ * @propemits false false
+ */
+
+/**
+ * Show the wallpaper behind the content when there is no compositor.
+ *
+ * `draw_wallpaper` then fills areas with the part of the wallpaper behind the
+ * drawable, and `wallpaper::changed` is emitted when that part changes.
+ *
+ * @property pseudo_transparent
+ * @tparam[opt=false] boolean pseudo_transparent
+ * @propemits false false
+ * @see draw_wallpaper
+ */
+
 /**
  * @signal button::press
  */
@@ -86,6 +141,25 @@
  * @signal property::surface
  */
 
+/**
+ * @signal property::shm
+ */
+
+/**
+ * @signal property::pseudo_transparent
+ */
+
+/** Emitted on `pseudo_transparent` drawables when the wallpaper behind them
+ * changed.
+ *
+ * @signal wallpaper::changed
+ * @tparam integer x The x coordinate of the changed area, in drawable
+ *  coordinates.
+ * @tparam integer y The y coordinate of the changed area.
+ * @tparam integer width The width of the changed area.
+ * @tparam integer height The height of the changed area.
+ */
+
 /** Get the number of instances.
  *
  * @return The number of drawable objects alive.
@@ -110,13 +184,246 @@ drawable_t *make_drawable(lua_State *L, drawable_refresh_callback *callback, voi
     return p;
 }
 
+/** Get the cairo image format matching the pixmaps of drawables.
+ * \return The format, or CAIRO_FORMAT_INVALID if cairo has none that matches.
+ */
+static cairo_format_t drawable_shm_format(void) {
+    const xcb_setup_t *setup = xcb_get_setup(globalconf.connection);
+    const uint16_t     one   = 1;
+    bool               lsb   = *(const uint8_t *)&one == 1;
+
+    if ((setup->image_byte_order == XCB_IMAGE_ORDER_LSB_FIRST) != lsb) return CAIRO_FORMAT_INVALID;
+    if (globalconf.visual->red_mask != 0xff0000 || globalconf.visual->green_mask != 0xff00 ||
+        globalconf.visual->blue_mask != 0xff)
+        return CAIRO_FORMAT_INVALID;
+
+    for (xcb_format_iterator_t it = xcb_setup_pixmap_formats_iterator(setup); it.rem;
+         xcb_format_next(&it))
+        if (it.data->depth == globalconf.default_depth && it.data->bits_per_pixel != 32)
+            return CAIRO_FORMAT_INVALID;
+
+    switch (globalconf.default_depth) {
+        case 32: return CAIRO_FORMAT_ARGB32;
+        case 24: return CAIRO_FORMAT_RGB24;
+        default: return CAIRO_FORMAT_INVALID;
+    }
+}
+
+/** Check if drawables can draw into MIT-SHM segments.
+ * \return True if the X server supports MIT-SHM with a usable pixmap format.
+ */
+bool drawable_shm_supported(void) {
+    return globalconf.have_shm && drawable_shm_format() != CAIRO_FORMAT_INVALID;
+}
+
+/** Attach a MIT-SHM segment with the size of a drawable's pixmap.
+ * \param d The drawable.
+ * \return False if that failed and a pixmap surface should be used instead.
+ */
+static bool drawable_create_shm_segment(drawable_t *d) {
+    int    stride = cairo_format_stride_for_width(drawable_shm_format(), d->pixmap_width);
+    size_t size   = (size_t)stride * d->pixmap_height;
+    int    id     = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (id < 0) return false;
+
+    void *data = shmat(id, NULL, 0);
+    if (data == (void *)-1) {
+        shmctl(id, IPC_RMID, NULL);
+        return false;
+    }
+
+    xcb_shm_seg_t        seg   = xcb_generate_id(globalconf.connection);
+    xcb_generic_error_t *error = xcb_request_check(
+        globalconf.connection, xcb_shm_attach_checked(globalconf.connection, seg, id, false));
+    /* The segment goes away once both sides detached it */
+    shmctl(id, IPC_RMID, NULL);
+    if (error) {
+        /* Most likely a remote X server, so do not try again */
+        warn("Cannot attach MIT-SHM segment, drawing into pixmaps instead");
+        globalconf.have_shm = false;
+        p_delete(&error);
+        shmdt(data);
+        return false;
+    }
+
+    d->shm_seg  = seg;
+    d->shm_data = data;
+    return true;
+}
+
+/** Round a drawable size up to the size class of pooled pixmaps.
+ * \param size The size.
+ * \return The size of the pixmap to create.
+ */
+static uint16_t drawable_pool_round(uint16_t size) {
+    return MIN((size + DRAWABLE_POOL_GRANULARITY - 1) / DRAWABLE_POOL_GRANULARITY *
+                   DRAWABLE_POOL_GRANULARITY,
+               UINT16_MAX);
+}
+
+static size_t drawable_pool_entry_bytes(const drawable_pool_entry_t *e) {
+    /* Segments are counted as a second copy of the pixmap */
+    size_t bytes = (size_t)e->width * e->height * 4;
+    return e->shm_seg ? 2 * bytes : bytes;
+}
+
+static void drawable_pool_entry_free(drawable_pool_entry_t *e) {
+    if (e->shm_fence.sequence) xcb_discard_reply(globalconf.connection, e->shm_fence.sequence);
+    xcb_free_pixmap(globalconf.connection, e->pixmap);
+    if (e->shm_seg) {
+        xcb_shm_detach(globalconf.connection, e->shm_seg);
+        shmdt(e->shm_data);
+    }
+}
+
+/** Free the oldest pooled pixmaps until the pool fits into a size.
+ * \param limit The size in bytes.
+ */
+static void drawable_pool_trim(size_t limit) {
+    while (drawable_pool.bytes > limit && drawable_pool.entries.len > 0) {
+        drawable_pool_entry_t e = drawable_pool_entry_array_take(&drawable_pool.entries, 0);
+        drawable_pool.bytes -= drawable_pool_entry_bytes(&e);
+        drawable_pool_entry_free(&e);
+    }
+}
+
+/** Give a drawable a pixmap of at least its size, reusing a pooled one if
+ * one is not much bigger than needed.
+ * \param d The drawable.
+ */
+static void drawable_acquire_pixmap(drawable_t *d) {
+    bool                   shm    = d->use_shm && drawable_shm_supported();
+    uint16_t               width  = drawable_pool_round(d->geometry.width);
+    uint16_t               height = drawable_pool_round(d->geometry.height);
+    drawable_pool_entry_t *best   = NULL;
+
+    foreach (e, drawable_pool.entries) {
+        size_t area = (size_t)e->width * e->height;
+        if ((e->shm_seg != XCB_NONE) != shm || e->width < d->geometry.width ||
+            e->height < d->geometry.height || area > 2 * (size_t)width * height)
+            continue;
+        if (!best || area < (size_t)best->width * best->height) best = e;
+    }
+
+    if (best) {
+        drawable_pool.hits++;
+        drawable_pool.bytes -= drawable_pool_entry_bytes(best);
+        drawable_pool_entry_t e = drawable_pool_entry_array_remove(&drawable_pool.entries, best);
+
+        /* The X server may still be reading an upload of the previous owner
+         * from the segment, don't let the new one draw over it */
+        if (e.shm_fence.sequence) {
+            xcb_get_input_focus_reply_t *reply =
+                xcb_get_input_focus_reply(globalconf.connection, e.shm_fence, NULL);
+            p_delete(&reply);
+        }
+        d->pixmap        = e.pixmap;
+        d->pixmap_width  = e.width;
+        d->pixmap_height = e.height;
+        d->shm_seg       = e.shm_seg;
+        d->shm_data      = e.shm_data;
+        return;
+    }
+
+    drawable_pool.misses++;
+    d->pixmap        = xcb_generate_id(globalconf.connection);
+    d->pixmap_width  = width;
+    d->pixmap_height = height;
+    xcb_create_pixmap(
+        globalconf.connection, globalconf.default_depth, d->pixmap, globalconf.screen->root, width,
+        height);
+    if (shm) drawable_create_shm_segment(d);
+}
+
+/** Put a drawable's pixmap into the pool.
+ * \param d The drawable.
+ */
+static void drawable_release_pixmap(drawable_t *d) {
+    drawable_pool_entry_t e = {
+        .pixmap    = d->pixmap,
+        .width     = d->pixmap_width,
+        .height    = d->pixmap_height,
+        .shm_seg   = d->shm_seg,
+        .shm_data  = d->shm_data,
+        .shm_fence = d->shm_fence};
+
+    drawable_pool_entry_array_append(&drawable_pool.entries, e);
+    drawable_pool.bytes += drawable_pool_entry_bytes(&e);
+    drawable_pool_trim(drawable_pool.limit);
+}
+
+/** Wait until the X server is done reading the MIT-SHM segment of a drawable.
+ * \param d The drawable.
+ */
+static void drawable_shm_wait(drawable_t *d) {
+    if (!d->shm_fence.sequence) return;
+    xcb_get_input_focus_reply_t *reply =
+        xcb_get_input_focus_reply(globalconf.connection, d->shm_fence, NULL);
+    p_delete(&reply);
+    d->shm_fence.sequence = 0;
+}
+
+/** Remember when the X server is done with the MIT-SHM segment of a drawable.
+ * \param d The drawable.
+ */
+static void drawable_shm_fence(drawable_t *d) {
+    if (!d->shm_seg) return;
+    if (d->shm_fence.sequence) xcb_discard_reply(globalconf.connection, d->shm_fence.sequence);
+    d->shm_fence = xcb_get_input_focus_unchecked(globalconf.connection);
+}
+
+static void drawable_create_surface(drawable_t *d) {
+    drawable_acquire_pixmap(d);
+    if (d->shm_seg)
+        d->surface = cairo_image_surface_create_for_data(
+            d->shm_data, drawable_shm_format(), d->geometry.width, d->geometry.height,
+            cairo_format_stride_for_width(drawable_shm_format(), d->pixmap_width));
+    else
+        d->surface = cairo_xcb_surface_create(
+            globalconf.connection, d->pixmap, globalconf.visual, d->geometry.width,
+            d->geometry.height);
+}
+
 static void drawable_unset_surface(drawable_t *d) {
     cairo_surface_finish(d->surface);
     cairo_surface_destroy(d->surface);
-    if (d->pixmap) xcb_free_pixmap(globalconf.connection, d->pixmap);
-    d->refreshed = false;
-    d->surface   = NULL;
-    d->pixmap    = XCB_NONE;
+    /* The pool takes over the fence */
+    if (d->pixmap) drawable_release_pixmap(d);
+    else if (d->shm_fence.sequence)
+        xcb_discard_reply(globalconf.connection, d->shm_fence.sequence);
+    d->refreshed          = false;
+    d->surface            = NULL;
+    d->pixmap             = XCB_NONE;
+    d->shm_seg            = XCB_NONE;
+    d->shm_data           = NULL;
+    d->shm_fence.sequence = 0;
+}
+
+/** Get the statistics of the pixmap pool.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ */
+int drawable_pool_push_stats(lua_State *L) {
+    lua_createtable(L, 0, 5);
+    lua_pushinteger(L, drawable_pool.hits);
+    lua_setfield(L, -2, "hits");
+    lua_pushinteger(L, drawable_pool.misses);
+    lua_setfield(L, -2, "misses");
+    lua_pushinteger(L, drawable_pool.entries.len);
+    lua_setfield(L, -2, "pixmaps");
+    lua_pushinteger(L, drawable_pool.bytes);
+    lua_setfield(L, -2, "bytes");
+    lua_pushinteger(L, drawable_pool.limit);
+    lua_setfield(L, -2, "limit");
+    return 1;
+}
+
+/** Set how much memory unused pixmaps may keep alive.
+ * \param limit The size in bytes.
+ */
+void drawable_pool_set_limit(size_t limit) {
+    drawable_pool.limit = limit;
+    drawable_pool_trim(limit);
 }
 
 void drawable_set_geometry(lua_State *L, int didx, area_t geom) {
@@ -127,48 +434,201 @@ void drawable_set_geometry(lua_State *L, int didx, area_t geom) {
     bool size_changed = (old.width != geom.width) || (old.height != geom.height);
     if (size_changed) drawable_unset_surface(d);
     if (size_changed && geom.width > 0 && geom.height > 0) {
-        d->pixmap = xcb_generate_id(globalconf.connection);
-        xcb_create_pixmap(
-            globalconf.connection, globalconf.default_depth, d->pixmap, globalconf.screen->root,
-            geom.width, geom.height);
-        d->surface = cairo_xcb_surface_create(
-            globalconf.connection, d->pixmap, globalconf.visual, geom.width, geom.height);
-        luna_object_emit_signal(L, didx, ":property.surface", 0);
+        drawable_create_surface(d);
+        luna_object_emit_signal_id(L, didx, LUNA_SIGNAL(":property.surface"), 0);
     }
 
-    if (!AREA_EQUAL(old, geom)) luna_object_emit_signal(L, didx, ":property.geometry", 0);
-    if (old.x != geom.x) luna_object_emit_signal(L, didx, ":property.x", 0);
-    if (old.y != geom.y) luna_object_emit_signal(L, didx, ":property.y", 0);
-    if (old.width != geom.width) luna_object_emit_signal(L, didx, ":property.width", 0);
-    if (old.height != geom.height) luna_object_emit_signal(L, didx, ":property.height", 0);
+    if (AREA_EQUAL(old, geom)) return;
+
+    /* Fetch the signal store once for the whole batch, signals without slots
+     * are rejected by its listener bitmap. */
+    lua_getfield(L, didx, "Signals");
+    luna_signal_store_emit_id(L, -1, LUNA_SIGNAL(":property.geometry"), 0);
+    if (old.x != geom.x) luna_signal_store_emit_id(L, -1, LUNA_SIGNAL(":property.x"), 0);
+    if (old.y != geom.y) luna_signal_store_emit_id(L, -1, LUNA_SIGNAL(":property.y"), 0);
+    if (old.width != geom.width)
+        luna_signal_store_emit_id(L, -1, LUNA_SIGNAL(":property.width"), 0);
+    if (old.height != geom.height)
+        luna_signal_store_emit_id(L, -1, LUNA_SIGNAL(":property.height"), 0);
+    lua_pop(L, 1);
+}
+
+/** Tell a drawable that the wallpaper changed, if it is pseudo-transparent
+ * and overlaps the changed area.
+ * \param L The Lua VM state.
+ * \param didx The index of the drawable on the stack.
+ * \param area The changed area, in root window coordinates.
+ */
+void drawable_wallpaper_changed(lua_State *L, int didx, area_t area) {
+    drawable_t *d  = luaC_checkuclass(L, didx, "Drawable");
+    int         x1 = MAX(AREA_LEFT(area), AREA_LEFT(d->geometry));
+    int         y1 = MAX(AREA_TOP(area), AREA_TOP(d->geometry));
+    int         x2 = MIN(AREA_RIGHT(area), AREA_RIGHT(d->geometry));
+    int         y2 = MIN(AREA_BOTTOM(area), AREA_BOTTOM(d->geometry));
+
+    if (!d->pseudo_transparent || x1 >= x2 || y1 >= y2) return;
+
+    didx = lua_absindex(L, didx);
+    lua_pushinteger(L, x1 - d->geometry.x);
+    lua_pushinteger(L, y1 - d->geometry.y);
+    lua_pushinteger(L, x2 - x1);
+    lua_pushinteger(L, y2 - y1);
+    luna_object_emit_signal_id(L, didx, LUNA_SIGNAL(":wallpaper.changed"), 4);
 }
 
 static void lunaL_drawable_alloc(lua_State *L) {
-    drawable_t *d       = lua_newuserdatauv(L, sizeof(drawable_t), 1);
-    d->refresh_callback = NULL;
-    d->refresh_data     = NULL;
-    d->refreshed        = false;
-    d->surface          = NULL;
-    d->pixmap           = XCB_NONE;
+    drawable_t *d         = lua_newuserdatauv(L, sizeof(drawable_t), 1);
+    d->refcount           = 0;
+    d->refresh_callback   = NULL;
+    d->refresh_data       = NULL;
+    d->refreshed          = false;
+    d->surface            = NULL;
+    d->pixmap             = XCB_NONE;
+    d->use_shm            = globalconf.drawable_shm;
+    d->shm_seg            = XCB_NONE;
+    d->shm_data           = NULL;
+    d->shm_fence          = (xcb_get_input_focus_cookie_t) {0};
+    d->pseudo_transparent = false;
 }
 
 static void lunaL_drawable_gc(lua_State *L, void *d) {
     drawable_unset_surface((drawable_t *)d);
 }
 
+/** Copy an area of a drawable's pixmap to the screen, clipped to its size.
+ * \param d The drawable.
+ * \param x The x coordinate of the area, in drawable coordinates.
+ * \param y The y coordinate of the area, in drawable coordinates.
+ * \param width The width of the area.
+ * \param height The height of the area.
+ */
+static void drawable_refresh_area(drawable_t *d, int x, int y, int width, int height) {
+    int x1 = MAX(x, 0);
+    int y1 = MAX(y, 0);
+    int x2 = MIN(x + width, d->geometry.width);
+    int y2 = MIN(y + height, d->geometry.height);
+
+    if (x1 >= x2 || y1 >= y2) return;
+
+    /* Images are copied to the pixmap first, which stays the source for
+     * exposures and for the refresh callback */
+    if (d->shm_seg) {
+        cairo_surface_flush(d->surface);
+        xcb_shm_put_image(
+            globalconf.connection, d->pixmap, globalconf.gc, d->pixmap_width, d->pixmap_height, x1,
+            y1, x2 - x1, y2 - y1, x1, y1, globalconf.default_depth, XCB_IMAGE_FORMAT_Z_PIXMAP, false,
+            d->shm_seg, 0);
+    }
+
+    (*d->refresh_callback)(
+        d->refresh_data, (area_t) {.x = x1, .y = y1, .width = x2 - x1, .height = y2 - y1});
+}
+
+/** Call a function for each area in a list of rectangles.
+ * \param L The Lua VM state.
+ * \param idx The index of the list on the stack.
+ * \param d The drawable the areas belong to.
+ * \param func The function, called with the drawable and the area.
+ */
+static void drawable_foreach_area(
+    lua_State *L, int idx, drawable_t *d, void (*func)(drawable_t *, int, int, int, int)) {
+    luaL_checktype(L, idx, LUA_TTABLE);
+    for (lua_Integer i = 1, n = luaL_len(L, idx); i <= n; i++) {
+        lua_rawgeti(L, idx, i);
+        luaL_checktype(L, -1, LUA_TTABLE);
+        int x      = luaA_getopt_integer(L, -1, "x", 0);
+        int y      = luaA_getopt_integer(L, -1, "y", 0);
+        int width  = luaA_getopt_integer(L, -1, "width", 0);
+        int height = luaA_getopt_integer(L, -1, "height", 0);
+        lua_pop(L, 1);
+        func(d, x, y, width, height);
+    }
+}
+
+/** Copy the wallpaper behind an area of a drawable into its pixmap, clipped to
+ * its size.
+ * \param d The drawable.
+ * \param x The x coordinate of the area, in drawable coordinates.
+ * \param y The y coordinate of the area, in drawable coordinates.
+ * \param width The width of the area.
+ * \param height The height of the area.
+ */
+static void drawable_copy_wallpaper(drawable_t *d, int x, int y, int width, int height) {
+    int x1 = MAX(x, 0);
+    int y1 = MAX(y, 0);
+    int x2 = MIN(x + width, d->geometry.width);
+    int y2 = MIN(y + height, d->geometry.height);
+
+    if (x1 >= x2 || y1 >= y2) return;
+
+    xcb_copy_area(
+        globalconf.connection, globalconf.wallpaper_pixmap, d->pixmap, globalconf.gc,
+        d->geometry.x + x1, d->geometry.y + y1, x1, y1, x2 - x1, y2 - y1);
+    cairo_surface_mark_dirty_rectangle(d->surface, x1, y1, x2 - x1, y2 - y1);
+}
+
 /** Refresh a drawable's content. This has to be called whenever some drawing to
  * the drawable's surface has been done and should become visible.
  *
+ * When a list of rectangles is given, only those parts of the drawable are
+ * copied to the screen. Everything is copied otherwise.
+ *
+ * When the drawable draws into shared memory, the X server reads the surface
+ * after this returns. Get the `surface` property again before drawing the next
+ * frame, which waits for that.
+ *
+ * @tparam[opt] table rects A list of tables with `x`, `y`, `width` and
+ *  `height` keys, in drawable coordinates.
  * @method refresh
  * @noreturn
  */
 static int lunaL_drawable_refresh(lua_State *L) {
     drawable_t *drawable = luaC_checkuclass(L, 1, "Drawable");
     drawable->refreshed  = true;
-    (*drawable->refresh_callback)(drawable->refresh_data);
+
+    if (lua_isnoneornil(L, 2)) {
+        drawable_refresh_area(drawable, 0, 0, drawable->geometry.width, drawable->geometry.height);
+        drawable_shm_fence(drawable);
+        return 0;
+    }
+
+    drawable_foreach_area(L, 2, drawable, drawable_refresh_area);
+    drawable_shm_fence(drawable);
     return 0;
 }
 
+/** Fill parts of a pseudo-transparent drawable with the wallpaper behind it.
+ *
+ * The X server copies the wallpaper from the pixmap of the root window, so it
+ * never has to be read back. Nothing is drawn when the drawable is not
+ * `pseudo_transparent`, draws into shared memory or when the wallpaper pixmap
+ * has another depth. The caller has to paint `root.wallpaper()` itself then.
+ *
+ * @tparam[opt] table rects A list of tables with `x`, `y`, `width` and
+ *  `height` keys, in drawable coordinates. Everything is filled otherwise.
+ * @treturn boolean Whether the wallpaper was drawn.
+ * @method draw_wallpaper
+ */
+static int lunaL_drawable_draw_wallpaper(lua_State *L) {
+    drawable_t *drawable = luaC_checkuclass(L, 1, "Drawable");
+
+    if (!lua_isnoneornil(L, 2)) luaL_checktype(L, 2, LUA_TTABLE);
+    if (!drawable->pseudo_transparent || !drawable->surface || drawable->shm_seg ||
+        !globalconf.wallpaper_pixmap) {
+        lua_pushboolean(L, false);
+        return 1;
+    }
+
+    /* Cairo must not have drawing of its own pending for these areas */
+    cairo_surface_flush(drawable->surface);
+    if (lua_isnoneornil(L, 2))
+        drawable_copy_wallpaper(drawable, 0, 0, drawable->geometry.width, drawable->geometry.height);
+    else drawable_foreach_area(L, 2, drawable, drawable_copy_wallpaper);
+
+    lua_pushboolean(L, true);
+    return 1;
+}
+
 /** Get drawable geometry. The geometry consists of x, y, width and height.
  *
  * @treturn table A table with drawable coordinates and geometry.
@@ -181,16 +641,55 @@ static int lunaL_drawable_geometry(lua_State *L) {
 
 lunaL_getter(drawable, surface) {
     drawable_t *drawable = luaC_checkuclass(L, 1, "Drawable");
+    drawable_shm_wait(drawable);
     if (drawable->surface) /* Lua gets its own reference which it will have to destroy */
         lua_pushlightuserdata(L, cairo_surface_reference(drawable->surface));
     else lua_pushnil(L);
     return 1;
 }
 
+lunaL_getter(drawable, shm) {
+    drawable_t *drawable = luaC_checkuclass(L, 1, "Drawable");
+    lua_pushboolean(L, drawable->shm_seg != XCB_NONE);
+    return 1;
+}
+
+lunaL_setter(drawable, shm) {
+    drawable_t *drawable = luaC_checkuclass(L, 1, "Drawable");
+    bool        b        = luaA_checkboolean(L, 2);
+    if (b == drawable->use_shm) return 0;
+
+    drawable->use_shm = b;
+    if (drawable->surface) {
+        drawable_unset_surface(drawable);
+        drawable_create_surface(drawable);
+        luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.surface"), 0);
+    }
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.shm"), 0);
+    return 0;
+}
+
+lunaL_getter(drawable, pseudo_transparent) {
+    drawable_t *drawable = luaC_checkuclass(L, 1, "Drawable");
+    lua_pushboolean(L, drawable->pseudo_transparent);
+    return 1;
+}
+
+lunaL_setter(drawable, pseudo_transparent) {
+    drawable_t *drawable = luaC_checkuclass(L, 1, "Drawable");
+    bool        b        = luaA_checkboolean(L, 2);
+    if (b == drawable->pseudo_transparent) return 0;
+
+    drawable->pseudo_transparent = b;
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.pseudo_transparent"), 0);
+    return 0;
+}
+
 static luaL_Reg drawable_methods[] = {
-    {"refresh",  lunaL_drawable_refresh },
-    {"geometry", lunaL_drawable_geometry},
-    {NULL,       NULL                   }
+    {"refresh",        lunaL_drawable_refresh       },
+    {"draw_wallpaper", lunaL_drawable_draw_wallpaper},
+    {"geometry",       lunaL_drawable_geometry      },
+    {NULL,             NULL                         }
 };
 
 static luaC_Class drawable_class = {
@@ -204,6 +703,8 @@ static luaC_Class drawable_class = {
 void luaC_register_drawable(lua_State *L) {
     static const luna_Prop props[] = {
         lunaL_readonly_prop(drawable, surface),
+        lunaL_prop(drawable, shm),
+        lunaL_prop(drawable, pseudo_transparent),
         {NULL, NULL, NULL}
     };
 
@@ -24,28 +24,50 @@
 #ifndef AWESOME_OBJECTS_DRAWABLE_H
 #define AWESOME_OBJECTS_DRAWABLE_H
 
+#include "common/refcount.h"
 #include "draw.h"
 
-typedef void drawable_refresh_callback(void *);
+#include <xcb/shm.h>
+
+/** Copy the given area (in drawable coordinates) of the pixmap to the screen. */
+typedef void drawable_refresh_callback(void *, area_t);
 
 /** drawable type */
 typedef struct drawable_t {
+    LUNA_OBJECT_HEADER
     /** The pixmap we are drawing to. */
-    xcb_pixmap_t               pixmap;
+    xcb_pixmap_t                 pixmap;
     /** Surface for drawing. */
-    cairo_surface_t           *surface;
+    cairo_surface_t             *surface;
     /** The geometry of the drawable (in root window coordinates). */
-    area_t                     geometry;
+    area_t                       geometry;
+    /** Size of the pixmap, which can be bigger than the geometry. */
+    uint16_t                     pixmap_width;
+    uint16_t                     pixmap_height;
     /** Surface contents are undefined if this is false. */
-    bool                       refreshed;
+    bool                         refreshed;
     /** Callback for refreshing. */
-    drawable_refresh_callback *refresh_callback;
+    drawable_refresh_callback   *refresh_callback;
     /** Data for refresh callback. */
-    void                      *refresh_data;
+    void                        *refresh_data;
+    /** Should the surface be an image in a MIT-SHM segment? */
+    bool                         use_shm;
+    /** The MIT-SHM segment of the surface, or XCB_NONE. */
+    xcb_shm_seg_t                shm_seg;
+    /** The local mapping of the MIT-SHM segment. */
+    void                        *shm_data;
+    /** Request sent after the last put of the segment to the pixmap. */
+    xcb_get_input_focus_cookie_t shm_fence;
+    /** Is the wallpaper drawn behind the content? */
+    bool                         pseudo_transparent;
 } drawable_t;
 
 drawable_t *make_drawable(lua_State *L, drawable_refresh_callback *callback, void *data);
 void        drawable_set_geometry(lua_State *, int, area_t);
+void        drawable_wallpaper_changed(lua_State *, int, area_t);
+bool        drawable_shm_supported(void);
+int         drawable_pool_push_stats(lua_State *);
+void        drawable_pool_set_limit(size_t);
 void        luaC_register_drawable(lua_State *);
 
 #endif
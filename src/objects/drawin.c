@@ -41,6 +41,7 @@
 #include "objects/client.h"
 #include "objects/screen.h"
 #include "systray.h"
+#include "winreg.h"
 #include "xwindow.h"
 
 #include "math.h"
@@ -146,6 +147,9 @@
  * @function set_newindex_miss_handler
  */
 
+/** Visible drawins with pending geometry changes */
+static drawin_array_t drawin_dirty;
+
 /** Kick out systray windows.
  */
 static void drawin_systray_kickout(drawin_t *w) {
@@ -174,8 +178,8 @@ static void drawin_update_drawing(lua_State *L, int widx) {
 /** Refresh the window content by copying its pixmap data to its window.
  * \param w The drawin to refresh.
  */
-static inline void drawin_refresh_pixmap(drawin_t *w) {
-    drawin_refresh_pixmap_partial(w, 0, 0, w->geometry.width, w->geometry.height);
+static void drawin_refresh_pixmap(drawin_t *w, area_t area) {
+    drawin_refresh_pixmap_partial(w, area.x, area.y, area.width, area.height);
 }
 
 static void drawin_apply_moveresize(drawin_t *w) {
@@ -191,11 +195,25 @@ static void drawin_apply_moveresize(drawin_t *w) {
     client_restore_enterleave_events();
 }
 
+/** Queue a drawin for the next refresh. Hidden drawins are queued again
+ * when they get mapped.
+ * \param w The drawin.
+ */
+static void drawin_queue_refresh(drawin_t *w) {
+    if (!w->visible || w->refresh_queued) return;
+    w->refresh_queued = true;
+    drawin_array_append(&drawin_dirty, w);
+}
+
+/** Apply the pending geometry changes of every visible drawin which has some.
+ */
 void drawin_refresh(void) {
-    foreach (item, globalconf.drawins) {
+    foreach (item, drawin_dirty) {
+        globalconf.refresh_count.drawin++;
+        (*item)->refresh_queued = false;
         drawin_apply_moveresize(*item);
-        window_border_refresh((window_t *)*item);
     }
+    drawin_dirty.len = 0;
 }
 
 /** Get all drawins into a table.
@@ -229,16 +247,19 @@ static void drawin_moveresize(lua_State *L, int udx, area_t geometry) {
     if (w->geometry.height <= 0) w->geometry.height = old_geometry.height;
 
     w->geometry_dirty = true;
+    drawin_queue_refresh(w);
     drawin_update_drawing(L, udx);
 
     if (!AREA_EQUAL(old_geometry, w->geometry))
-        luna_object_emit_signal(L, udx, ":property.geometry", 0);
-    if (old_geometry.x != w->geometry.x) luna_object_emit_signal(L, udx, ":property.x", 0);
-    if (old_geometry.y != w->geometry.y) luna_object_emit_signal(L, udx, ":property.y", 0);
+        luna_object_emit_signal_id(L, udx, LUNA_SIGNAL(":property.geometry"), 0);
+    if (old_geometry.x != w->geometry.x)
+        luna_object_emit_signal_id(L, udx, LUNA_SIGNAL(":property.x"), 0);
+    if (old_geometry.y != w->geometry.y)
+        luna_object_emit_signal_id(L, udx, LUNA_SIGNAL(":property.y"), 0);
     if (old_geometry.width != w->geometry.width)
-        luna_object_emit_signal(L, udx, ":property.width", 0);
+        luna_object_emit_signal_id(L, udx, LUNA_SIGNAL(":property.width"), 0);
     if (old_geometry.height != w->geometry.height)
-        luna_object_emit_signal(L, udx, ":property.height", 0);
+        luna_object_emit_signal_id(L, udx, LUNA_SIGNAL(":property.height"), 0);
 
     screen_t *old_screen = screen_getbycoord(old_geometry.x, old_geometry.y);
     screen_t *new_screen = screen_getbycoord(w->geometry.x, w->geometry.y);
@@ -282,17 +303,27 @@ static void drawin_map(lua_State *L, int widx) {
     stack_windows();
     /* Add it to the list of visible drawins */
     drawin_array_append(&globalconf.drawins, drawin);
+    winreg_insert(drawin->window, WINREG_DRAWIN, drawin);
     /* Make sure it has a surface */
     if (drawin->drawable->surface == NULL) drawin_update_drawing(L, widx);
 }
 
 static void drawin_unmap(drawin_t *drawin) {
     xcb_unmap_window(globalconf.connection, drawin->window);
+    winreg_remove(drawin->window);
     foreach (item, globalconf.drawins)
         if (*item == drawin) {
             drawin_array_remove(&globalconf.drawins, item);
             break;
         }
+    if (drawin->refresh_queued) {
+        drawin->refresh_queued = false;
+        foreach (item, drawin_dirty)
+            if (*item == drawin) {
+                drawin_array_remove(&drawin_dirty, item);
+                break;
+            }
+    }
 }
 
 /** Get a drawin by its window.
@@ -300,9 +331,7 @@ static void drawin_unmap(drawin_t *drawin) {
  * \return A drawin if found, NULL otherwise.
  */
 drawin_t *drawin_getbywin(xcb_window_t win) {
-    foreach (w, globalconf.drawins)
-        if ((*w)->window == win) return *w;
-    return NULL;
+    return winreg_lookup(win, WINREG_DRAWIN);
 }
 
 /** Set a drawin visible or not.
@@ -332,7 +361,7 @@ static void drawin_set_visible(lua_State *L, int udx, bool v) {
             luna_object_unref(L, drawin);
         }
 
-        luna_object_emit_signal(L, udx, ":property.visible", 0);
+        luna_object_emit_signal_id(L, udx, LUNA_SIGNAL(":property.visible"), 0);
         if (strut_has_value(&drawin->strut)) {
             screen_update_workarea(screen_getbycoord(drawin->geometry.x, drawin->geometry.y));
         }
@@ -342,6 +371,7 @@ static void drawin_set_visible(lua_State *L, int udx, bool v) {
 static void lunaL_drawin_alloc(lua_State *L) {
     xcb_screen_t *s    = globalconf.screen;
     drawin_t     *w    = lua_newuserdatauv(L, sizeof(drawin_t), 1);
+    p_clear(w, 1);
 
     w->visible         = false;
 
@@ -350,6 +380,7 @@ static void lunaL_drawin_alloc(lua_State *L) {
     w->geometry.width  = 1;
     w->geometry.height = 1;
     w->geometry_dirty  = false;
+    w->refresh_queued  = false;
     w->type            = _NET_WM_WINDOW_TYPE_NORMAL;
 
     make_drawable(L, (drawable_refresh_callback *)drawin_refresh_pixmap, w);
@@ -516,7 +547,7 @@ lunaL_setter(drawin, ontop) {
     if (b != drawin->ontop) {
         drawin->ontop = b;
         stack_windows();
-        luna_object_emit_signal(L, 1, ":property.ontop", 0);
+        luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.ontop"), 0);
     }
     return 0;
 }
@@ -542,7 +573,7 @@ lunaL_setter(drawin, cursor) {
             p_delete(&drawin->cursor);
             drawin->cursor = a_strdup(buf);
             xwindow_set_cursor(drawin->window, cursor);
-            luna_object_emit_signal(L, 1, ":property.cursor", 0);
+            luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.cursor"), 0);
         }
     }
     return 0;
@@ -605,7 +636,7 @@ lunaL_setter(drawin, shape_bounding) {
         drawin->window, drawin->geometry.width + 2 * drawin->border_width,
         drawin->geometry.height + 2 * drawin->border_width, XCB_SHAPE_SK_BOUNDING, surf,
         -drawin->border_width);
-    luna_object_emit_signal(L, 1, ":property.shape_bounding", 0);
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.shape_bounding"), 0);
     return 0;
 }
 
@@ -638,7 +669,7 @@ lunaL_setter(drawin, shape_clip) {
     xwindow_set_shape(
         drawin->window, drawin->geometry.width, drawin->geometry.height, XCB_SHAPE_SK_CLIP, surf,
         0);
-    luna_object_emit_signal(L, 1, ":property.shape_clip", 0);
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.shape_clip"), 0);
     return 0;
 }
 
@@ -672,7 +703,7 @@ lunaL_setter(drawin, shape_input) {
         drawin->window, drawin->geometry.width + 2 * drawin->border_width,
         drawin->geometry.height + 2 * drawin->border_width, XCB_SHAPE_SK_INPUT, surf,
         -drawin->border_width);
-    luna_object_emit_signal(L, 1, ":property.shape_input", 0);
+    luna_object_emit_signal_id(L, 1, LUNA_SIGNAL(":property.shape_input"), 0);
     return 0;
 }
 
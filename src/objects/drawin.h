@@ -43,6 +43,8 @@ struct drawin_t {
     area_t      geometry;
     /** Do we have a pending geometry change that still needs to be applied? */
     bool        geometry_dirty;
+    /** Is the drawin queued for the next refresh? */
+    bool        refresh_queued;
 };
 
 ARRAY_FUNCS(drawin_t *, drawin, DO_NOTHING)
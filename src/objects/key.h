@@ -30,6 +30,7 @@
 #include "globalconf.h"
 
 struct keyb_t {
+    LUNA_OBJECT_HEADER
     /** Key modifier */
     uint16_t      modifiers;
     /** Keysym */
@@ -943,6 +943,8 @@ static void screen_removed(lua_State *L, int sidx) {
         if ((*c)->screen == screen)
             screen_client_moveto(*c, screen_getbycoord((*c)->geometry.x, (*c)->geometry.y), false);
     }
+
+    luna_object_drop_coalesced_signals(L, sidx);
 }
 
 void screen_cleanup(void) {
@@ -38,6 +38,7 @@ typedef enum {
 } screen_lifecycle_t;
 
 struct a_screen {
+    LUNA_OBJECT_HEADER
     bool               valid;
     /** Who manages the screen lifecycle */
     screen_lifecycle_t lifecycle;
@@ -299,6 +299,9 @@
  * @staticfct set_newindex_miss_handler
  */
 
+/** Bits currently handed out to tags */
+static bitset_t tag_bits;
+
 void tag_unref_simplified(tag_t **tag) {
     lua_State *L = globalconf_get_lua_State();
     luna_object_unref(L, *tag);
@@ -307,14 +310,28 @@ void tag_unref_simplified(tag_t **tag) {
 static void lunaL_tag_alloc(lua_State *L) {
     tag_t *t = lua_newuserdatauv(L, sizeof(tag_t), 1);
     p_clear(t, 1);
+    t->bit = bitset_first_clear(&tag_bits);
+    bitset_set(&tag_bits, t->bit);
 }
 
 static void lunaL_tag_gc(lua_State *L, void *p) {
     tag_t *tag = (tag_t *)p;
+    /* Every tagged client holds a reference, so no client still has this bit
+     * set and it can be handed out again. */
+    bitset_clear(&globalconf.selected_tags, tag->bit);
+    bitset_clear(&tag_bits, tag->bit);
     client_array_wipe(&tag->clients);
     p_delete(&tag->name);
 }
 
+/** Keep the selected tags bitset in sync with a tag.
+ * \param tag The tag.
+ */
+static void tag_update_selected_bit(tag_t *tag) {
+    if (tag->activated && tag->selected) bitset_set(&globalconf.selected_tags, tag->bit);
+    else bitset_clear(&globalconf.selected_tags, tag->bit);
+}
+
 /** View or unview a tag.
  * \param L The Lua VM state.
  * \param udx The index of the tag on the stack.
@@ -324,6 +341,7 @@ static void tag_view(lua_State *L, int udx, bool view) {
     tag_t *tag = luaC_checkuclass(L, udx, "Tag");
     if (tag->selected != view) {
         tag->selected = view;
+        tag_update_selected_bit(tag);
         banning_need_update();
         foreach (screen, globalconf.screens)
             screen_update_workarea(*screen);
@@ -362,6 +380,7 @@ void tag_client(lua_State *L, client_t *c) {
     }
 
     client_array_append(&t->clients, c);
+    bitset_set(&c->tags, t->bit);
     ewmh_client_update_desktop(c);
     banning_need_update();
     screen_update_workarea(c->screen);
@@ -378,6 +397,7 @@ void untag_client(client_t *c, tag_t *t) {
         if (t->clients.tab[i] == c) {
             lua_State *L = globalconf_get_lua_State();
             client_array_take(&t->clients, i);
+            bitset_clear(&c->tags, t->bit);
             banning_need_update();
             ewmh_client_update_desktop(c);
             screen_update_workarea(c->screen);
@@ -393,10 +413,7 @@ void untag_client(client_t *c, tag_t *t) {
  * \return true if the client is tagged with the tag, false otherwise.
  */
 bool is_client_tagged(client_t *c, tag_t *t) {
-    for (int i = 0; i < t->clients.len; i++)
-        if (t->clients.tab[i] == c) return true;
-
-    return false;
+    return bitset_test(&c->tags, t->bit);
 }
 
 /** Get the index of the tag with focused client or first selected
@@ -513,6 +530,7 @@ lunaL_setter(tag, activated) {
     if (activated == tag->activated) return 0;
 
     tag->activated = activated;
+    tag_update_selected_bit(tag);
     if (activated) {
         lua_pushvalue(L, 1);
         tag_array_append(&globalconf.tags, luna_object_ref(L, -1));
@@ -525,6 +543,7 @@ lunaL_setter(tag, activated) {
 
         if (tag->selected) {
             tag->selected = false;
+            tag_update_selected_bit(tag);
             luna_object_emit_signal(L, 1, ":property.selected", 0);
             banning_need_update();
         }
@@ -35,12 +35,15 @@ ARRAY_FUNCS(tag_t *, tag, tag_unref_simplified)
 
 /** Tag type */
 struct tag {
+    LUNA_OBJECT_HEADER
     /** Tag name */
     char          *name;
     /** true if activated */
     bool           activated;
     /** true if selected */
     bool           selected;
+    /** Index of this tag in client and selected tag bitsets */
+    int            bit;
     /** clients in this tag */
     client_array_t clients;
 };
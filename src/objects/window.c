@@ -63,13 +63,34 @@
 #include "property.h"
 #include "xwindow.h"
 
+DO_ARRAY(window_t *, window_object, DO_NOTHING)
+
+/** Windows with pending border changes, in the order they were changed */
+static window_object_array_t border_dirty;
+
 static xcb_window_t window_get(window_t *window) {
     if (window->frame_window != XCB_NONE) return window->frame_window;
     return window->window;
 }
 
-static void lunaL_window_gc(lua_State *L, void *window) {
-    button_array_wipe(&((window_t *)window)->buttons);
+/** Queue a window for the next border refresh.
+ * \param window The window.
+ */
+static void window_queue_border_refresh(window_t *window) {
+    if (window->border_need_update) return;
+    window->border_need_update = true;
+    window_object_array_append(&border_dirty, window);
+}
+
+static void lunaL_window_gc(lua_State *L, void *p) {
+    window_t *window = (window_t *)p;
+    button_array_wipe(&window->buttons);
+    if (!window->border_need_update) return;
+    foreach (w, border_dirty)
+        if (*w == window) {
+            window_object_array_remove(&border_dirty, w);
+            break;
+        }
 }
 
 /** Get or set mouse buttons bindings on a window.
@@ -122,14 +143,43 @@ void window_set_opacity(lua_State *L, int idx, double opacity) {
     }
 }
 
-void window_border_refresh(window_t *window) {
-    if (!window->border_need_update) return;
-    window->border_need_update = false;
-    xwindow_set_border_color(window_get(window), &window->border_color);
-    if (window->window)
+/** Set a window border width.
+ * \param L The Lua VM state.
+ * \param idx The index of the window on the stack.
+ * \param width The border width.
+ */
+void window_set_border_width(lua_State *L, int idx, int width) {
+    window_t *window    = luaC_checkuclass(L, idx, "Window");
+    uint16_t  old_width = window->border_width;
+
+    if (width == window->border_width || width < 0) return;
+
+    window_queue_border_refresh(window);
+    window->border_width = width;
+
+    if (window->border_width_callback)
+        (*window->border_width_callback)(window, old_width, width);
+
+    luna_object_emit_signal_id(L, idx, LUNA_SIGNAL(":property.border_width"), 0);
+}
+
+/** Apply the pending border changes of every window which has some.
+ */
+void window_border_refresh(void) {
+    foreach (w, border_dirty) {
+        window_t *window           = *w;
+        window->border_need_update = false;
+        globalconf.refresh_count.border++;
+
+        /* Unmanaged clients stay around until they are collected */
+        if (!window->window) continue;
+
+        xwindow_set_border_color(window_get(window), &window->border_color);
         xcb_configure_window(
             globalconf.connection, window_get(window), XCB_CONFIG_WINDOW_BORDER_WIDTH,
             (uint32_t[]) {window->border_width});
+    }
+    border_dirty.len = 0;
 }
 
 static xproperty_t *luaA_find_xproperty(lua_State *L, int idx) {
@@ -298,7 +348,7 @@ lunaL_setter(window, _border_color) {
 
     if (color_name && color_init_reply(color_init_unchecked(
                           &window->border_color, color_name, len, globalconf.visual))) {
-        window->border_need_update = true;
+        window_queue_border_refresh(window);
         luna_object_emit_signal(L, -3, ":property.border_color", 0);
     }
 
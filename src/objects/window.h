@@ -51,6 +51,7 @@ typedef enum {
 } window_type_t;
 
 #define WINDOW_OBJECT_HEADER                   \
+    LUNA_OBJECT_HEADER                         \
     /** The X window number */                 \
     xcb_window_t   window;                     \
     /** The frame window, might be XCB_NONE */ \
@@ -79,7 +80,7 @@ typedef struct {
 
 void     window_set_opacity(lua_State *, int, double);
 void     window_set_border_width(lua_State *, int, int);
-void     window_border_refresh(window_t *);
+void     window_border_refresh(void);
 int      luaA_window_get_type(lua_State *, window_t *);
 int      luaA_window_set_type(lua_State *, window_t *);
 uint32_t window_translate_type(window_type_t);
@@ -29,14 +29,51 @@
 #include "objects/drawin.h"
 #include "objects/selection_getter.h"
 #include "objects/selection_transfer.h"
+#include "systray.h"
 #include "xwindow.h"
 
 #include <xcb/xcb_atom.h>
 
+/** A function requesting a property of a window. */
+typedef xcb_get_property_cookie_t property_get_func_t(xcb_window_t);
+
+/** A property requested for a PropertyNotify of the batch being handled. */
+typedef struct {
+    const xcb_property_notify_event_t *event;
+    xcb_get_property_cookie_t          cookie;
+} property_prefetch_t;
+
+DO_ARRAY(property_prefetch_t, property_prefetch, DO_NOTHING)
+
+/** The properties of a batch of events are all requested before the first
+ * event is handled, so that a burst costs one round trip. */
+static struct {
+    /** The requests, in the order of their events */
+    property_prefetch_array_t requests;
+    /** Index of the request of the next PropertyNotify */
+    int                       next;
+    /** The request for the event being handled, until a handler takes it */
+    property_prefetch_t      *current;
+} property_prefetched;
+
+/** Get the cookie of the property of the PropertyNotify being handled,
+ * requesting it now if it was not requested with its batch.
+ * \param window The window of the event.
+ * \param get The function requesting the property.
+ * \return The cookie.
+ */
+static xcb_get_property_cookie_t property_cookie(xcb_window_t window, property_get_func_t *get) {
+    property_prefetch_t *request = property_prefetched.current;
+
+    if (!request) return get(window);
+    property_prefetched.current = NULL;
+    return request->cookie;
+}
+
 #define HANDLE_TEXT_PROPERTY(funcname, atom, setfunc)                                    \
-    xcb_get_property_cookie_t property_get_##funcname(client_t *c) {                     \
+    xcb_get_property_cookie_t property_get_##funcname(xcb_window_t window) {              \
         return xcb_get_property(                                                         \
-            globalconf.connection, false, c->window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, \
+            globalconf.connection, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0,    \
             UINT_MAX);                                                                   \
     }                                                                                    \
     void property_update_##funcname(client_t *c, xcb_get_property_cookie_t cookie) {     \
@@ -50,7 +87,9 @@
     }                                                                                    \
     static void property_handle_##funcname(uint8_t state, xcb_window_t window) {         \
         client_t *c = client_getbywin(window);                                           \
-        if (c) property_update_##funcname(c, property_get_##funcname(c));                \
+        if (c)                                                                           \
+            property_update_##funcname(                                                  \
+                c, property_cookie(window, property_get_##funcname));                    \
     }
 
 HANDLE_TEXT_PROPERTY(wm_name, XCB_ATOM_WM_NAME, client_set_alt_name)
@@ -62,10 +101,10 @@ HANDLE_TEXT_PROPERTY(wm_window_role, WM_WINDOW_ROLE, client_set_role)
 
 #undef HANDLE_TEXT_PROPERTY
 
-#define HANDLE_PROPERTY(name)                                                \
-    static void property_handle_##name(uint8_t state, xcb_window_t window) { \
-        client_t *c = client_getbywin(window);                               \
-        if (c) property_update_##name(c, property_get_##name(c));            \
+#define HANDLE_PROPERTY(name)                                                                 \
+    static void property_handle_##name(uint8_t state, xcb_window_t window) {                  \
+        client_t *c = client_getbywin(window);                                                \
+        if (c) property_update_##name(c, property_cookie(window, property_get_##name));       \
     }
 
 HANDLE_PROPERTY(wm_protocols)
@@ -80,8 +119,8 @@ HANDLE_PROPERTY(motif_wm_hints)
 
 #undef HANDLE_PROPERTY
 
-xcb_get_property_cookie_t property_get_wm_transient_for(client_t *c) {
-    return xcb_icccm_get_wm_transient_for_unchecked(globalconf.connection, c->window);
+xcb_get_property_cookie_t property_get_wm_transient_for(xcb_window_t window) {
+    return xcb_icccm_get_wm_transient_for_unchecked(globalconf.connection, window);
 }
 
 void property_update_wm_transient_for(client_t *c, xcb_get_property_cookie_t cookie) {
@@ -105,9 +144,9 @@ void property_update_wm_transient_for(client_t *c, xcb_get_property_cookie_t coo
     client_find_transient_for(c);
 }
 
-xcb_get_property_cookie_t property_get_wm_client_leader(client_t *c) {
+xcb_get_property_cookie_t property_get_wm_client_leader(xcb_window_t window) {
     return xcb_get_property_unchecked(
-        globalconf.connection, false, c->window, WM_CLIENT_LEADER, XCB_ATOM_WINDOW, 0, 32);
+        globalconf.connection, false, window, WM_CLIENT_LEADER, XCB_ATOM_WINDOW, 0, 32);
 }
 
 /** Update leader hint of a client.
@@ -126,8 +165,8 @@ void property_update_wm_client_leader(client_t *c, xcb_get_property_cookie_t coo
     p_delete(&reply);
 }
 
-xcb_get_property_cookie_t property_get_wm_normal_hints(client_t *c) {
-    return xcb_icccm_get_wm_normal_hints_unchecked(globalconf.connection, c->window);
+xcb_get_property_cookie_t property_get_wm_normal_hints(xcb_window_t window) {
+    return xcb_icccm_get_wm_normal_hints_unchecked(globalconf.connection, window);
 }
 
 /** Update the size hints of a client.
@@ -140,12 +179,12 @@ void property_update_wm_normal_hints(client_t *c, xcb_get_property_cookie_t cook
     xcb_icccm_get_wm_normal_hints_reply(globalconf.connection, cookie, &c->size_hints, NULL);
 
     luna_object_push(L, c);
-    luna_object_emit_signal(L, -1, ":property.size_hints", 0);
+    luna_object_emit_signal_id(L, -1, LUNA_SIGNAL(":property.size_hints"), 0);
     lua_pop(L, 1);
 }
 
-xcb_get_property_cookie_t property_get_wm_hints(client_t *c) {
-    return xcb_icccm_get_wm_hints_unchecked(globalconf.connection, c->window);
+xcb_get_property_cookie_t property_get_wm_hints(xcb_window_t window) {
+    return xcb_icccm_get_wm_hints_unchecked(globalconf.connection, window);
 }
 
 /** Update the WM hints of a client.
@@ -162,7 +201,7 @@ void property_update_wm_hints(client_t *c, xcb_get_property_cookie_t cookie) {
 
     /*TODO v5: Add a context */
     lua_pushboolean(L, xcb_icccm_wm_hints_get_urgency(&wmh));
-    luna_object_emit_signal(L, -2, ":request.urgent", 1);
+    luna_object_emit_signal_id(L, -2, LUNA_SIGNAL(":request.urgent"), 1);
 
     if (wmh.flags & XCB_ICCCM_WM_HINT_INPUT) c->nofocus = !wmh.input;
 
@@ -180,8 +219,8 @@ void property_update_wm_hints(client_t *c, xcb_get_property_cookie_t cookie) {
     lua_pop(L, 1);
 }
 
-xcb_get_property_cookie_t property_get_wm_class(client_t *c) {
-    return xcb_icccm_get_wm_class_unchecked(globalconf.connection, c->window);
+xcb_get_property_cookie_t property_get_wm_class(xcb_window_t window) {
+    return xcb_icccm_get_wm_class_unchecked(globalconf.connection, window);
 }
 
 /** Update WM_CLASS of a client.
@@ -204,26 +243,27 @@ void property_update_wm_class(client_t *c, xcb_get_property_cookie_t cookie) {
 static void property_handle_net_wm_strut_partial(uint8_t state, xcb_window_t window) {
     client_t *c = client_getbywin(window);
 
-    if (c) ewmh_process_client_strut(c);
+    if (c) ewmh_process_client_strut(c, property_cookie(window, ewmh_client_strut_get_unchecked));
 }
 
-xcb_get_property_cookie_t property_get_net_wm_icon(client_t *c) {
-    return ewmh_window_icon_get_unchecked(c->window);
+xcb_get_property_cookie_t property_get_net_wm_icon(xcb_window_t window) {
+    return ewmh_window_icon_get_unchecked(window);
 }
 
+/** Update the icons of a client from _NET_WM_ICON. The images are only
+ * transferred once the icons are asked for.
+ * \param c The client.
+ * \param cookie Cookie returned by property_get_net_wm_icon.
+ */
 void property_update_net_wm_icon(client_t *c, xcb_get_property_cookie_t cookie) {
-    cairo_surface_array_t array = ewmh_window_icon_get_reply(cookie);
-    if (array.len == 0) {
-        cairo_surface_array_wipe(&array);
-        return;
-    }
+    if (!ewmh_window_icon_check_reply(cookie)) return;
     c->have_ewmh_icon = true;
-    client_set_icons(c, array);
+    client_invalidate_ewmh_icons(c);
 }
 
-xcb_get_property_cookie_t property_get_net_wm_pid(client_t *c) {
+xcb_get_property_cookie_t property_get_net_wm_pid(xcb_window_t window) {
     return xcb_get_property_unchecked(
-        globalconf.connection, false, c->window, _NET_WM_PID, XCB_ATOM_CARDINAL, 0L, 1L);
+        globalconf.connection, false, window, _NET_WM_PID, XCB_ATOM_CARDINAL, 0L, 1L);
 }
 
 void property_update_net_wm_pid(client_t *c, xcb_get_property_cookie_t cookie) {
@@ -244,9 +284,9 @@ void property_update_net_wm_pid(client_t *c, xcb_get_property_cookie_t cookie) {
     p_delete(&reply);
 }
 
-xcb_get_property_cookie_t property_get_motif_wm_hints(client_t *c) {
+xcb_get_property_cookie_t property_get_motif_wm_hints(xcb_window_t window) {
     return xcb_get_property_unchecked(
-        globalconf.connection, false, c->window, _MOTIF_WM_HINTS, _MOTIF_WM_HINTS, 0L, 5L);
+        globalconf.connection, false, window, _MOTIF_WM_HINTS, _MOTIF_WM_HINTS, 0L, 5L);
 }
 
 void property_update_motif_wm_hints(client_t *c, xcb_get_property_cookie_t cookie) {
@@ -274,8 +314,8 @@ void property_update_motif_wm_hints(client_t *c, xcb_get_property_cookie_t cooki
     lua_pop(L, 1);
 }
 
-xcb_get_property_cookie_t property_get_wm_protocols(client_t *c) {
-    return xcb_icccm_get_wm_protocols_unchecked(globalconf.connection, c->window, WM_PROTOCOLS);
+xcb_get_property_cookie_t property_get_wm_protocols(xcb_window_t window) {
+    return xcb_icccm_get_wm_protocols_unchecked(globalconf.connection, window, WM_PROTOCOLS);
 }
 
 /** Update the list of supported protocols for a client.
@@ -297,7 +337,7 @@ void property_update_wm_protocols(client_t *c, xcb_get_property_cookie_t cookie)
  * \param window The window to obtain update the property with.
  */
 static void property_handle_xembed_info(uint8_t state, xcb_window_t window) {
-    xembed_window_t *emwin = xembed_getbywin(&globalconf.embedded, window);
+    xembed_window_t *emwin = systray_getbywin(window);
 
     if (emwin) {
         xcb_get_property_cookie_t cookie = xcb_get_property(
@@ -309,119 +349,252 @@ static void property_handle_xembed_info(uint8_t state, xcb_window_t window) {
 }
 
 static void property_handle_net_wm_opacity(uint8_t state, xcb_window_t window) {
-    lua_State *L      = globalconf_get_lua_State();
-    drawin_t  *drawin = drawin_getbywin(window);
+    lua_State *L   = globalconf_get_lua_State();
+    void      *obj = drawin_getbywin(window);
 
-    if (drawin) {
-        luna_object_push(L, drawin);
-        window_set_opacity(L, -1, xwindow_get_opacity(drawin->window));
-        lua_pop(L, -1);
-    } else {
-        client_t *c = client_getbywin(window);
-        if (c) {
-            luna_object_push(L, c);
-            window_set_opacity(L, -1, xwindow_get_opacity(c->window));
-            lua_pop(L, 1);
-        }
-    }
+    if (!obj) obj = client_getbywin(window);
+    if (!obj) return;
+
+    /* Drawins and clients both get the property of their own window */
+    luna_object_push(L, obj);
+    window_set_opacity(
+        L, -1,
+        xwindow_get_opacity_from_cookie(property_cookie(window, xwindow_get_opacity_unchecked)));
+    lua_pop(L, 1);
 }
 
 static void property_handle_xrootpmap_id(uint8_t state, xcb_window_t window) {
-    lua_State *L = globalconf_get_lua_State();
-    root_update_wallpaper();
-    luna_emit_global_signal(L, "wallpaper_changed", 0);
+    root_wallpaper_changed();
 }
 
-/** The property notify event handler handling xproperties.
- * \param ev The event.
+/** What to do when a property changes. */
+typedef struct {
+    xcb_atom_t atom;
+    /** The handler of the property, or NULL */
+    void (*handler)(uint8_t state, xcb_window_t window);
+    /** The request the handler sends for clients and drawins, or NULL */
+    property_get_func_t *get;
+    /** The id of ":xproperty.<name>" if the property is registered, else 0 */
+    luna_signal_id_t xproperty_signal;
+} property_dispatch_t;
+
+#define PROPERTY_DISPATCH_MIN_SIZE 64
+
+/** Open addressing hash table with linear probing keyed by atom, so finding
+ * what to do for a PropertyNotify is one lookup. Nothing is ever removed.
+ * XCB_NONE marks an empty slot. */
+static struct {
+    property_dispatch_t *tab;
+    /** Number of used slots */
+    int len;
+    /** Number of slots, always a power of two */
+    int size;
+} property_dispatch;
+
+/** Find the slot of an atom, or the empty slot where it would go.
+ * \param atom The atom.
+ * \return A slot index.
  */
-static void property_handle_propertynotify_xproperty(xcb_property_notify_event_t *ev) {
-    lua_State   *L = globalconf_get_lua_State();
-    xproperty_t *prop;
-    xproperty_t  lookup = {.atom = ev->atom};
-    buffer_t     buf;
-    void        *obj;
+static int property_dispatch_slot(xcb_atom_t atom) {
+    /* Atoms are small sequential numbers, scatter them like window ids */
+    uint32_t h    = atom * 2654435769u;
+    int      mask = property_dispatch.size - 1;
+    int      i    = (h ^ (h >> 16)) & mask;
 
-    prop = xproperty_array_lookup(&globalconf.xproperties, &lookup);
-    if (!prop) /* Property is not registered */
-        return;
+    while (property_dispatch.tab[i].atom != XCB_NONE && property_dispatch.tab[i].atom != atom)
+        i = (i + 1) & mask;
 
-    if (ev->window != globalconf.screen->root) {
-        obj = client_getbywin(ev->window);
-        if (!obj) obj = drawin_getbywin(ev->window);
-        if (!obj) return;
-    } else obj = NULL;
+    return i;
+}
 
-    /* Get us the name of the property */
-    buffer_inita(&buf, a_strlen(prop->name) + a_strlen(":xproperty.") + 1);
-    buffer_addf(&buf, ":xproperty.%s", prop->name);
+/** Get what to do for an atom.
+ * \param atom The atom.
+ * \return The entry, or NULL if the property is of no interest.
+ */
+static property_dispatch_t *property_dispatch_lookup(xcb_atom_t atom) {
+    if (!property_dispatch.len) return NULL;
 
-    /* And emit the right signal */
-    if (obj) {
-        luna_object_push(L, obj);
-        luna_object_emit_signal(L, -1, buf.s, 0);
-        lua_pop(L, 1);
-    } else luna_emit_global_signal(L, buf.s, 0);
-    buffer_wipe(&buf);
+    property_dispatch_t *entry = &property_dispatch.tab[property_dispatch_slot(atom)];
+
+    return entry->atom == atom ? entry : NULL;
 }
 
-/** The property notify event handler.
- * \param ev The event.
+/** Get the entry of an atom, adding an empty one if there is none.
+ * \param atom The atom.
+ * \return The entry.
  */
-void property_handle_propertynotify(xcb_property_notify_event_t *ev) {
-    void (*handler)(uint8_t state, xcb_window_t window) = NULL;
+static property_dispatch_t *property_dispatch_get(xcb_atom_t atom) {
+    if ((property_dispatch.len + 1) * 2 > property_dispatch.size) {
+        property_dispatch_t *old      = property_dispatch.tab;
+        int                  old_size = property_dispatch.size;
 
-    globalconf.timestamp                                = ev->time;
+        property_dispatch.size = old_size ? old_size * 2 : PROPERTY_DISPATCH_MIN_SIZE;
+        property_dispatch.tab  = p_new(property_dispatch_t, property_dispatch.size);
 
-    property_handle_propertynotify_xproperty(ev);
-    selection_transfer_handle_propertynotify(ev);
+        for (int i = 0; i < old_size; i++)
+            if (old[i].atom != XCB_NONE)
+                property_dispatch.tab[property_dispatch_slot(old[i].atom)] = old[i];
 
-    /* Find the correct event handler */
-#define HANDLE(atom_, cb)    \
-    if (ev->atom == atom_) { \
-        handler = cb;        \
-    } else
-#define END return
+        p_delete(&old);
+    }
+
+    property_dispatch_t *entry = &property_dispatch.tab[property_dispatch_slot(atom)];
+
+    if (entry->atom == XCB_NONE) {
+        entry->atom = atom;
+        property_dispatch.len++;
+    }
+
+    return entry;
+}
+
+/** Fill the dispatch table with the properties we handle.
+ * Must be called once the atoms are known.
+ */
+void property_init(void) {
+#define HANDLE(atom, cb, get_)                                    \
+    do {                                                          \
+        property_dispatch_t *entry = property_dispatch_get(atom); \
+        entry->handler             = cb;                          \
+        entry->get                 = get_;                        \
+    } while (0)
 
     /* Xembed stuff */
-    HANDLE(_XEMBED_INFO, property_handle_xembed_info)
+    HANDLE(_XEMBED_INFO, property_handle_xembed_info, NULL);
 
     /* ICCCM stuff */
-    HANDLE(XCB_ATOM_WM_TRANSIENT_FOR, property_handle_wm_transient_for)
-    HANDLE(WM_CLIENT_LEADER, property_handle_wm_client_leader)
-    HANDLE(XCB_ATOM_WM_NORMAL_HINTS, property_handle_wm_normal_hints)
-    HANDLE(XCB_ATOM_WM_HINTS, property_handle_wm_hints)
-    HANDLE(XCB_ATOM_WM_NAME, property_handle_wm_name)
-    HANDLE(XCB_ATOM_WM_ICON_NAME, property_handle_wm_icon_name)
-    HANDLE(XCB_ATOM_WM_CLASS, property_handle_wm_class)
-    HANDLE(WM_PROTOCOLS, property_handle_wm_protocols)
-    HANDLE(XCB_ATOM_WM_CLIENT_MACHINE, property_handle_wm_client_machine)
-    HANDLE(WM_WINDOW_ROLE, property_handle_wm_window_role)
+    HANDLE(
+        XCB_ATOM_WM_TRANSIENT_FOR, property_handle_wm_transient_for,
+        property_get_wm_transient_for);
+    HANDLE(WM_CLIENT_LEADER, property_handle_wm_client_leader, property_get_wm_client_leader);
+    HANDLE(
+        XCB_ATOM_WM_NORMAL_HINTS, property_handle_wm_normal_hints, property_get_wm_normal_hints);
+    HANDLE(XCB_ATOM_WM_HINTS, property_handle_wm_hints, property_get_wm_hints);
+    HANDLE(XCB_ATOM_WM_NAME, property_handle_wm_name, property_get_wm_name);
+    HANDLE(XCB_ATOM_WM_ICON_NAME, property_handle_wm_icon_name, property_get_wm_icon_name);
+    HANDLE(XCB_ATOM_WM_CLASS, property_handle_wm_class, property_get_wm_class);
+    HANDLE(WM_PROTOCOLS, property_handle_wm_protocols, property_get_wm_protocols);
+    HANDLE(
+        XCB_ATOM_WM_CLIENT_MACHINE, property_handle_wm_client_machine,
+        property_get_wm_client_machine);
+    HANDLE(WM_WINDOW_ROLE, property_handle_wm_window_role, property_get_wm_window_role);
 
     /* EWMH stuff */
-    HANDLE(_NET_WM_NAME, property_handle_net_wm_name)
-    HANDLE(_NET_WM_ICON_NAME, property_handle_net_wm_icon_name)
-    HANDLE(_NET_WM_STRUT_PARTIAL, property_handle_net_wm_strut_partial)
-    HANDLE(_NET_WM_ICON, property_handle_net_wm_icon)
-    HANDLE(_NET_WM_PID, property_handle_net_wm_pid)
-    HANDLE(_NET_WM_WINDOW_OPACITY, property_handle_net_wm_opacity)
+    HANDLE(_NET_WM_NAME, property_handle_net_wm_name, property_get_net_wm_name);
+    HANDLE(_NET_WM_ICON_NAME, property_handle_net_wm_icon_name, property_get_net_wm_icon_name);
+    HANDLE(
+        _NET_WM_STRUT_PARTIAL, property_handle_net_wm_strut_partial,
+        ewmh_client_strut_get_unchecked);
+    HANDLE(_NET_WM_ICON, property_handle_net_wm_icon, property_get_net_wm_icon);
+    HANDLE(_NET_WM_PID, property_handle_net_wm_pid, property_get_net_wm_pid);
+    HANDLE(
+        _NET_WM_WINDOW_OPACITY, property_handle_net_wm_opacity, xwindow_get_opacity_unchecked);
 
     /* MOTIF hints */
-    HANDLE(_MOTIF_WM_HINTS, property_handle_motif_wm_hints)
+    HANDLE(_MOTIF_WM_HINTS, property_handle_motif_wm_hints, property_get_motif_wm_hints);
 
     /* background change */
-    HANDLE(_XROOTPMAP_ID, property_handle_xrootpmap_id)
+    HANDLE(_XROOTPMAP_ID, property_handle_xrootpmap_id, NULL);
 
     /* selection transfers */
-    HANDLE(AWESOME_SELECTION_ATOM, property_handle_awesome_selection_atom)
-
-    /* If nothing was found, return */
-    END;
+    HANDLE(AWESOME_SELECTION_ATOM, property_handle_awesome_selection_atom, NULL);
 
 #undef HANDLE
-#undef END
+}
+
+/** The property notify event handler handling xproperties.
+ * \param ev The event.
+ * \param id The id of the signal of the xproperty.
+ */
+static void property_handle_propertynotify_xproperty(
+    xcb_property_notify_event_t *ev, luna_signal_id_t id) {
+    lua_State *L = globalconf_get_lua_State();
+    void      *obj;
+
+    if (ev->window != globalconf.screen->root) {
+        obj = client_getbywin(ev->window);
+        if (!obj) obj = drawin_getbywin(ev->window);
+        if (!obj) return;
+    } else obj = NULL;
+
+    /* And emit the right signal */
+    if (obj) {
+        luna_object_push(L, obj);
+        luna_object_emit_signal_id(L, -1, id, 0);
+        lua_pop(L, 1);
+    } else luna_emit_global_signal_id(L, id, 0);
+}
+
+/** The property notify event handler.
+ * \param ev The event.
+ */
+void property_handle_propertynotify(xcb_property_notify_event_t *ev) {
+    property_dispatch_t *entry   = property_dispatch_lookup(ev->atom);
+    property_prefetch_t *request = NULL;
+
+    globalconf.timestamp = ev->time;
+
+    /* Events are handled in order, so the request is the next one unless an
+     * event was not handled at all */
+    for (int i = property_prefetched.next; i < property_prefetched.requests.len; i++)
+        if (property_prefetched.requests.tab[i].event == ev) {
+            for (; property_prefetched.next < i; property_prefetched.next++)
+                xcb_discard_reply(
+                    globalconf.connection,
+                    property_prefetched.requests.tab[property_prefetched.next].cookie.sequence);
+            request = &property_prefetched.requests.tab[property_prefetched.next++];
+            break;
+        }
+
+    if (entry && entry->xproperty_signal)
+        property_handle_propertynotify_xproperty(ev, entry->xproperty_signal);
+    selection_transfer_handle_propertynotify(ev);
 
-    (*handler)(ev->state, ev->window);
+    /* If nothing was found, there is nothing to do */
+    if (!entry || !entry->handler) {
+        if (request) xcb_discard_reply(globalconf.connection, request->cookie.sequence);
+        return;
+    }
+
+    property_prefetched.current = request;
+    entry->handler(ev->state, ev->window);
+    /* The handler did not need the property after all */
+    if (property_prefetched.current)
+        xcb_discard_reply(globalconf.connection, request->cookie.sequence);
+    property_prefetched.current = NULL;
+}
+
+/** Request the properties of all PropertyNotifies of a batch of events, so
+ * that their handlers do not wait for one reply after another.
+ * \param events The events, NULL for dropped ones.
+ * \param count The number of events.
+ */
+void property_prefetch(xcb_generic_event_t **events, int count) {
+    for (int i = 0; i < count; i++) {
+        if (!events[i] || XCB_EVENT_RESPONSE_TYPE(events[i]) != XCB_PROPERTY_NOTIFY) continue;
+
+        xcb_property_notify_event_t *ev    = (void *)events[i];
+        property_dispatch_t         *entry = property_dispatch_lookup(ev->atom);
+        if (!entry || !entry->get) continue;
+        /* The handlers only look at clients, and at drawins for the opacity */
+        if (!client_getbywin(ev->window) &&
+            !(ev->atom == _NET_WM_WINDOW_OPACITY && drawin_getbywin(ev->window)))
+            continue;
+
+        property_prefetch_array_append(
+            &property_prefetched.requests,
+            (property_prefetch_t) {.event = ev, .cookie = entry->get(ev->window)});
+    }
+}
+
+/** Forget the properties requested for a batch of events once it is handled.
+ */
+void property_prefetch_finish(void) {
+    for (int i = property_prefetched.next; i < property_prefetched.requests.len; i++)
+        xcb_discard_reply(
+            globalconf.connection, property_prefetched.requests.tab[i].cookie.sequence);
+    property_prefetched.requests.len = 0;
+    property_prefetched.next         = 0;
 }
 
 /** Register a new xproperty.
@@ -459,8 +632,10 @@ int luaA_register_xproperty(lua_State *L) {
         if (found->type != property.type)
             return luaL_error(L, "xproperty '%s' already registered with different type", name);
     } else {
-        property.name = a_strdup(name);
+        property.name   = a_strdup(name);
+        property.signal = luna_signal_intern_suffix(LUNA_SIGNAL(":xproperty."), name);
         xproperty_array_insert(&globalconf.xproperties, property);
+        property_dispatch_get(property.atom)->xproperty_signal = property.signal;
     }
 
     return 0;
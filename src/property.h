@@ -22,10 +22,11 @@
 #ifndef AWESOME_PROPERTY_H
 #define AWESOME_PROPERTY_H
 
+#include "common/signals.h"
 #include "objects/client.h"
 
-#define PROPERTY(funcname)                                          \
-    xcb_get_property_cookie_t property_get_##funcname(client_t *c); \
+#define PROPERTY(funcname)                                                \
+    xcb_get_property_cookie_t property_get_##funcname(xcb_window_t window); \
     void property_update_##funcname(client_t *c, xcb_get_property_cookie_t cookie)
 
 PROPERTY(wm_name);
@@ -46,7 +47,10 @@ PROPERTY(motif_wm_hints);
 
 #undef PROPERTY
 
+void property_init(void);
 void property_handle_propertynotify(xcb_property_notify_event_t *ev);
+void property_prefetch(xcb_generic_event_t **, int);
+void property_prefetch_finish(void);
 int  luaA_register_xproperty(lua_State *L);
 int  luaA_set_xproperty(lua_State *L);
 int  luaA_get_xproperty(lua_State *L);
@@ -54,6 +58,8 @@ int  luaA_get_xproperty(lua_State *L);
 struct xproperty {
     xcb_atom_t  atom;
     const char *name;
+    /** The id of ":xproperty.<name>", emitted when the property changes */
+    luna_signal_id_t signal;
     enum {
         /* UTF8_STRING */
         PROP_STRING,
@@ -43,114 +43,350 @@
 #include "common/atoms.h"
 #include "common/lualib.h"
 #include "common/xcursor.h"
-#include "common/xutil.h"
+#include "loopstats.h"
 #include "objects/button.h"
+#include "objects/client.h"
+#include "objects/drawin.h"
 #include "objects/key.h"
 #include "xwindow.h"
 
 #include "math.h"
 
 #include <cairo-xcb.h>
+#include <glib-unix.h>
 #include <lauxlib.h>
-#include <xcb/xcb_aux.h>
 #include <xcb/xtest.h>
 
 static int miss_index_handler    = LUA_REFNIL;
 static int miss_newindex_handler = LUA_REFNIL;
 static int miss_call_handler     = LUA_REFNIL;
 
-static void root_set_wallpaper_pixmap(xcb_connection_t *c, xcb_pixmap_t p) {
-    xcb_get_property_cookie_t prop_c;
-    xcb_get_property_reply_t *prop_r;
+/** Rows of the wallpaper painted at once. */
+#define WALLPAPER_BAND_HEIGHT 64
+/** Painting the wallpaper yields to the main loop once a slice took this long. */
+#define WALLPAPER_SLICE_NS    (2 * 1000 * 1000)
+
+/** Wallpapers are painted into a pixmap from idle callbacks and set once
+ * done. The pixmaps are owned by a helper connection, which survives our exit
+ * so that the wallpaper does, and which setters of later wallpapers can kill
+ * to free it. */
+static struct {
+    /** Connection which owns our wallpaper pixmaps */
+    xcb_connection_t *helper;
+    /** The wallpaper pixmap we set last */
+    xcb_pixmap_t      current;
+    /** _XROOTPMAP_ID changes of our own which are not notified yet */
+    unsigned int      own_changes;
+    /** Areas of the wallpapers we set which are not notified yet */
+    area_array_t      changed;
+    /** The wallpaper which is being painted */
+    struct {
+        xcb_pixmap_t                 pixmap;
+        /** Reply arriving once the helper created the pixmap */
+        xcb_get_input_focus_cookie_t created;
+        /** The old ESETROOT_PMAP_ID */
+        xcb_get_property_cookie_t    esetroot;
+        cairo_pattern_t             *pattern;
+        /** Surface for the pixmap, NULL until the pixmap is created */
+        cairo_surface_t             *surface;
+        /** Number of rows painted */
+        uint16_t                     painted;
+        /** The GLib source of the next step */
+        guint                        source;
+        /** The areas which differ from the current wallpaper */
+        area_array_t                 areas;
+    } pending;
+} root_wallpaper;
+
+/** Tell the pseudo-transparent drawables in front of a part of the wallpaper
+ * that it changed.
+ * \param L The Lua VM state.
+ * \param area The changed area.
+ */
+static void root_wallpaper_invalidate(lua_State *L, area_t area) {
+    foreach (w, globalconf.drawins) {
+        luna_object_push(L, *w);
+        luna_object_push_item(L, -1, (*w)->drawable);
+        drawable_wallpaper_changed(L, -1, area);
+        lua_pop(L, 2);
+    }
+
+    foreach (c, globalconf.clients)
+        for (client_titlebar_t bar = CLIENT_TITLEBAR_TOP; bar < CLIENT_TITLEBAR_COUNT; bar++) {
+            if (!(*c)->titlebar[bar].drawable) continue;
+            luna_object_push(L, *c);
+            luna_object_push_item(L, -1, (*c)->titlebar[bar].drawable);
+            drawable_wallpaper_changed(L, -1, area);
+            lua_pop(L, 2);
+        }
+}
+
+static gboolean root_wallpaper_emit_changed(gpointer data) {
+    lua_State   *L       = globalconf_get_lua_State();
+    area_array_t changed = root_wallpaper.changed;
+
+    /* Slots may set another wallpaper */
+    area_array_init(&root_wallpaper.changed);
+    foreach (area, changed)
+        root_wallpaper_invalidate(L, *area);
+    area_array_wipe(&changed);
+
+    luna_emit_global_signal_id(L, LUNA_SIGNAL("wallpaper_changed"), 0);
+    return G_SOURCE_REMOVE;
+}
+
+/** Drop the wallpaper which is being painted, if any.
+ */
+static void root_wallpaper_cancel(void) {
+    if (!root_wallpaper.pending.pixmap) return;
+
+    if (root_wallpaper.pending.source) g_source_remove(root_wallpaper.pending.source);
+    if (xcb_connection_has_error(root_wallpaper.helper)) {
+        /* The pixmap is gone already */
+        if (root_wallpaper.pending.surface) cairo_surface_destroy(root_wallpaper.pending.surface);
+    } else if (root_wallpaper.pending.surface) {
+        /* We already drew to it, so free it after that */
+        cairo_surface_finish(root_wallpaper.pending.surface);
+        cairo_surface_destroy(root_wallpaper.pending.surface);
+        xcb_free_pixmap(globalconf.connection, root_wallpaper.pending.pixmap);
+    } else {
+        xcb_discard_reply(root_wallpaper.helper, root_wallpaper.pending.created.sequence);
+        xcb_free_pixmap(root_wallpaper.helper, root_wallpaper.pending.pixmap);
+        xcb_flush(root_wallpaper.helper);
+    }
+    xcb_discard_reply(globalconf.connection, root_wallpaper.pending.esetroot.sequence);
+    cairo_pattern_destroy(root_wallpaper.pending.pattern);
+    area_array_wipe(&root_wallpaper.pending.areas);
+    p_clear(&root_wallpaper.pending, 1);
+}
+
+/** Connect the helper connection if it is not connected yet.
+ * \return True if the helper connection is usable.
+ */
+static bool root_wallpaper_connect(void) {
+    if (root_wallpaper.helper) {
+        /* Reading notices when another client killed the connection to free
+         * our wallpaper, which also freed all our pixmaps */
+        xcb_generic_event_t *event;
+        while ((event = xcb_poll_for_event(root_wallpaper.helper))) p_delete(&event);
+        if (!xcb_connection_has_error(root_wallpaper.helper)) return true;
+
+        root_wallpaper_cancel();
+        xcb_disconnect(root_wallpaper.helper);
+        root_wallpaper.current = XCB_NONE;
+    }
+
+    root_wallpaper.helper = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(root_wallpaper.helper)) {
+        xcb_disconnect(root_wallpaper.helper);
+        root_wallpaper.helper = NULL;
+        return false;
+    }
+
+    /* Make sure our pixmaps are not destroyed when we disconnect. */
+    xcb_set_close_down_mode(root_wallpaper.helper, XCB_CLOSE_DOWN_RETAIN_PERMANENT);
+    return true;
+}
+
+/** Make the painted pixmap the wallpaper.
+ */
+static void root_wallpaper_swap(void) {
+    xcb_connection_t         *c      = globalconf.connection;
     const xcb_screen_t       *screen = globalconf.screen;
+    xcb_pixmap_t              p      = root_wallpaper.pending.pixmap;
+    xcb_get_property_reply_t *prop_r;
 
-    /* We now have the pattern painted to the pixmap p. Now turn p into the root
-     * window's background pixmap.
-     */
+    prop_r = xcb_get_property_reply(c, root_wallpaper.pending.esetroot, NULL);
     xcb_change_window_attributes(c, screen->root, XCB_CW_BACK_PIXMAP, &p);
     xcb_clear_area(c, 0, screen->root, 0, 0, 0, 0);
 
-    prop_c =
-        xcb_get_property_unchecked(c, false, screen->root, ESETROOT_PMAP_ID, XCB_ATOM_PIXMAP, 0, 1);
-
     /* Theoretically, this should be enough to set the wallpaper. However, to
      * make pseudo-transparency work, clients need a way to get the wallpaper.
      * You can't query a window's back pixmap, so properties are (ab)used.
+     * We ignore our own PropertyNotify instead of grabbing the server.
      */
     xcb_change_property(
         c, XCB_PROP_MODE_REPLACE, screen->root, _XROOTPMAP_ID, XCB_ATOM_PIXMAP, 32, 1, &p);
     xcb_change_property(
         c, XCB_PROP_MODE_REPLACE, screen->root, ESETROOT_PMAP_ID, XCB_ATOM_PIXMAP, 32, 1, &p);
+    root_wallpaper.own_changes++;
 
-    /* Now make sure that the old wallpaper is freed (but only do this for ESETROOT_PMAP_ID) */
-    prop_r = xcb_get_property_reply(c, prop_c, NULL);
+    /* Now make sure that the old wallpaper is freed. Ours can be freed
+     * directly, others are killed (but only do this for ESETROOT_PMAP_ID) */
+    cairo_surface_destroy(globalconf.wallpaper);
+    globalconf.wallpaper        = root_wallpaper.pending.surface;
+    globalconf.wallpaper_pixmap = screen->root_depth == globalconf.default_depth ? p : XCB_NONE;
+    if (root_wallpaper.current) xcb_free_pixmap(c, root_wallpaper.current);
     if (prop_r && prop_r->value_len) {
         xcb_pixmap_t *rootpix = xcb_get_property_value(prop_r);
-        if (rootpix) xcb_kill_client(c, *rootpix);
+        if (rootpix && *rootpix != root_wallpaper.current && *rootpix != p)
+            xcb_kill_client(c, *rootpix);
     }
     p_delete(&prop_r);
+
+    root_wallpaper.current = p;
+    if (root_wallpaper.pending.areas.len == 0)
+        area_array_append(
+            &root_wallpaper.changed,
+            (area_t) {.width = screen->width_in_pixels, .height = screen->height_in_pixels});
+    area_array_splice(
+        &root_wallpaper.changed, root_wallpaper.changed.len, 0, root_wallpaper.pending.areas.tab,
+        root_wallpaper.pending.areas.len);
+    area_array_wipe(&root_wallpaper.pending.areas);
+    cairo_pattern_destroy(root_wallpaper.pending.pattern);
+    p_clear(&root_wallpaper.pending, 1);
+
+    /* Tell Lua that the wallpaper changed */
+    g_idle_add(root_wallpaper_emit_changed, NULL);
 }
 
-static bool root_set_wallpaper(cairo_pattern_t *pattern) {
-    lua_State          *L      = globalconf_get_lua_State();
-    xcb_connection_t   *c      = xcb_connect(NULL, NULL);
-    xcb_pixmap_t        p      = xcb_generate_id(c);
-    /* globalconf.connection should be connected to the same X11 server, so we
-     * can just use the info from that other connection.
-     */
-    const xcb_screen_t *screen = globalconf.screen;
-    uint16_t            width  = screen->width_in_pixels;
-    uint16_t            height = screen->height_in_pixels;
-    bool                result = false;
-    cairo_surface_t    *surface;
-    cairo_t            *cr;
+/** Paint bands of the pending wallpaper.
+ * \param budget Stop after the band which took longer than this in total, in
+ * nanoseconds. 0 paints everything.
+ * \return True if the wallpaper is completely painted.
+ */
+static bool root_wallpaper_paint(int64_t budget) {
+    int64_t  start  = loop_stats_now();
+    uint16_t width  = globalconf.screen->width_in_pixels;
+    uint16_t height = globalconf.screen->height_in_pixels;
+    cairo_t *cr     = cairo_create(root_wallpaper.pending.surface);
+
+    cairo_set_source(cr, root_wallpaper.pending.pattern);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    while (root_wallpaper.pending.painted < height) {
+        uint16_t rows = MIN(WALLPAPER_BAND_HEIGHT, height - root_wallpaper.pending.painted);
+        cairo_rectangle(cr, 0, root_wallpaper.pending.painted, width, rows);
+        cairo_fill(cr);
+        root_wallpaper.pending.painted += rows;
+        if (budget && loop_stats_now() - start > budget) break;
+    }
+    cairo_destroy(cr);
+    cairo_surface_flush(root_wallpaper.pending.surface);
 
-    if (xcb_connection_has_error(c)) goto disconnect;
+    loop_stats_record(LOOP_PHASE_WALLPAPER, start);
+    return root_wallpaper.pending.painted >= height;
+}
 
-    /* Create a pixmap and make sure it is already created, because we are going
-     * to use it from the other X11 connection (Juggling with X11 connections
-     * is a really, really bad idea).
+static void root_wallpaper_start_painting(void) {
+    /* Paint from the main connection so that cairo sees that it can tell the
+     * X server to copy between the (possible) old pixmap and the new one
+     * directly and doesn't need GetImage and PutImage.
      */
-    xcb_create_pixmap(c, screen->root_depth, p, screen->root, width, height);
-    xcb_aux_sync(c);
+    root_wallpaper.pending.surface = cairo_xcb_surface_create(
+        globalconf.connection, root_wallpaper.pending.pixmap,
+        draw_default_visual(globalconf.screen), globalconf.screen->width_in_pixels,
+        globalconf.screen->height_in_pixels);
+}
+
+static gboolean root_wallpaper_paint_cb(gpointer data) {
+    if (!root_wallpaper_paint(WALLPAPER_SLICE_NS)) return G_SOURCE_CONTINUE;
+
+    root_wallpaper.pending.source = 0;
+    root_wallpaper_swap();
+    return G_SOURCE_REMOVE;
+}
+
+/** Wait for the helper connection to create the pixmap, which has to happen
+ * before the main connection can use it.
+ */
+static gboolean root_wallpaper_created_cb(gint fd, GIOCondition condition, gpointer data) {
+    xcb_connection_t    *helper = root_wallpaper.helper;
+    xcb_generic_event_t *event;
+    void                *reply = NULL;
+    int                  done  = xcb_poll_for_reply(
+        helper, root_wallpaper.pending.created.sequence, &reply, NULL);
+
+    /* Errors for our requests, nothing else is selected */
+    while ((event = xcb_poll_for_event(helper))) p_delete(&event);
+    p_delete(&reply);
+
+    if (xcb_connection_has_error(helper)) {
+        warn("Lost the connection for setting the wallpaper");
+        root_wallpaper.pending.source = 0;
+        root_wallpaper_cancel();
+        return G_SOURCE_REMOVE;
+    }
+    if (!done) return G_SOURCE_CONTINUE;
+
+    root_wallpaper_start_painting();
+    root_wallpaper.pending.source = g_idle_add(root_wallpaper_paint_cb, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+/** Set the wallpaper which is being painted right now, blocking until the
+ * helper connection created its pixmap if needed.
+ */
+static void root_wallpaper_finish(void) {
+    if (!root_wallpaper.pending.pixmap) return;
+
+    if (root_wallpaper.pending.source) g_source_remove(root_wallpaper.pending.source);
+    root_wallpaper.pending.source = 0;
+    if (!root_wallpaper.pending.surface) {
+        xcb_get_input_focus_reply_t *reply =
+            xcb_get_input_focus_reply(root_wallpaper.helper, root_wallpaper.pending.created, NULL);
+        p_delete(&reply);
+    }
+
+    /* The pixmap died with the connection */
+    if (xcb_connection_has_error(root_wallpaper.helper)) {
+        warn("Lost the connection for setting the wallpaper");
+        root_wallpaper_cancel();
+        return;
+    }
+    if (!root_wallpaper.pending.surface) root_wallpaper_start_painting();
+    root_wallpaper_paint(0);
+    root_wallpaper_swap();
+}
 
-    /* Now paint to the picture from the main connection so that cairo sees that
-     * it can tell the X server to copy between the (possible) old pixmap and
-     * the new one directly and doesn't need GetImage and PutImage.
+/** Start setting the wallpaper.
+ * \param pattern The pattern to paint.
+ * \param areas The areas in which the pattern differs from the current
+ * wallpaper, or NULL if unknown.
+ * \param count The number of areas.
+ * \return False if there is no connection to create the pixmap with.
+ */
+static bool root_set_wallpaper(cairo_pattern_t *pattern, area_t *areas, int count) {
+    if (!root_wallpaper_connect()) return false;
+    root_wallpaper_cancel();
+
+    /* globalconf.connection should be connected to the same X11 server, so we
+     * can just use the info from that other connection.
      */
-    surface = cairo_xcb_surface_create(
-        globalconf.connection, p, draw_default_visual(screen), width, height);
-    cr = cairo_create(surface);
-    /* Paint the pattern to the surface */
-    cairo_set_source(cr, pattern);
-    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-    cairo_paint(cr);
-    cairo_destroy(cr);
-    cairo_surface_flush(surface);
-    xcb_aux_sync(globalconf.connection);
+    const xcb_screen_t *screen = globalconf.screen;
+    xcb_connection_t   *helper = root_wallpaper.helper;
+    xcb_pixmap_t        p      = xcb_generate_id(helper);
+
+    xcb_create_pixmap(
+        helper, screen->root_depth, p, screen->root, screen->width_in_pixels,
+        screen->height_in_pixels);
+    root_wallpaper.pending.pixmap   = p;
+    root_wallpaper.pending.created  = xcb_get_input_focus(helper);
+    root_wallpaper.pending.esetroot = xcb_get_property_unchecked(
+        globalconf.connection, false, screen->root, ESETROOT_PMAP_ID, XCB_ATOM_PIXMAP, 0, 1);
+    root_wallpaper.pending.pattern  = cairo_pattern_reference(pattern);
+    root_wallpaper.pending.source   = g_unix_fd_add(
+        xcb_get_file_descriptor(helper), G_IO_IN, root_wallpaper_created_cb, NULL);
+    if (areas) area_array_splice(&root_wallpaper.pending.areas, 0, 0, areas, count);
+    xcb_flush(helper);
+
+    return true;
+}
 
-    /* Change the wallpaper, without sending us a PropertyNotify event */
-    xcb_grab_server(globalconf.connection);
-    xcb_change_window_attributes(
-        globalconf.connection, globalconf.screen->root, XCB_CW_EVENT_MASK, (uint32_t[]) {0});
-    root_set_wallpaper_pixmap(globalconf.connection, p);
-    xcb_change_window_attributes(
-        globalconf.connection, globalconf.screen->root, XCB_CW_EVENT_MASK, ROOT_WINDOW_EVENT_MASK);
-    xutil_ungrab_server(globalconf.connection);
+/** Handle a change of _XROOTPMAP_ID.
+ */
+void root_wallpaper_changed(void) {
+    lua_State *L = globalconf_get_lua_State();
 
-    /* Make sure our pixmap is not destroyed when we disconnect. */
-    xcb_set_close_down_mode(c, XCB_CLOSE_DOWN_RETAIN_PERMANENT);
+    if (root_wallpaper.own_changes > 0) {
+        root_wallpaper.own_changes--;
+        return;
+    }
 
-    /* Tell Lua that the wallpaper changed */
-    cairo_surface_destroy(globalconf.wallpaper);
-    globalconf.wallpaper = surface;
-    luna_emit_global_signal(L, "wallpaper_changed", 0);
-
-    result = true;
-disconnect:
-    xcb_aux_sync(c);
-    xcb_disconnect(c);
-    return result;
+    root_update_wallpaper();
+    root_wallpaper_invalidate(
+        L, (area_t) {.width  = globalconf.screen->width_in_pixels,
+                     .height = globalconf.screen->height_in_pixels});
+    luna_emit_global_signal_id(L, LUNA_SIGNAL("wallpaper_changed"), 0);
 }
 
 void root_update_wallpaper(void) {
@@ -161,9 +397,10 @@ void root_update_wallpaper(void) {
     xcb_pixmap_t             *rootpix;
 
     cairo_surface_destroy(globalconf.wallpaper);
-    globalconf.wallpaper = NULL;
+    globalconf.wallpaper        = NULL;
+    globalconf.wallpaper_pixmap = XCB_NONE;
 
-    prop_c               = xcb_get_property_unchecked(
+    prop_c                      = xcb_get_property_unchecked(
         globalconf.connection, false, globalconf.screen->root, _XROOTPMAP_ID, XCB_ATOM_PIXMAP, 0,
         1);
     prop_r = xcb_get_property_reply(globalconf.connection, prop_c, NULL);
@@ -195,6 +432,7 @@ void root_update_wallpaper(void) {
 
     globalconf.wallpaper = cairo_xcb_surface_create(
         globalconf.connection, *rootpix, globalconf.default_visual, geom_r->width, geom_r->height);
+    if (geom_r->depth == globalconf.default_depth) globalconf.wallpaper_pixmap = *rootpix;
 
     p_delete(&prop_r);
     p_delete(&geom_r);
@@ -440,24 +678,54 @@ static int luaA_root_drawins(lua_State *L) {
 }
 
 /** Get the wallpaper as a cairo surface or set it as a cairo pattern.
+ *
+ * Setting the wallpaper paints the pattern in slices between main loop
+ * iterations. `wallpaper_changed` is emitted once it is set. Getting the
+ * wallpaper while one is being painted finishes it first.
+ *
+ * Only the pseudo-transparent drawables in front of the changed areas get
+ * repainted, which is the whole root window unless told otherwise.
  *
  * @param pattern A cairo pattern as light userdata
- * @return A cairo surface or nothing.
+ * @tparam[opt] table areas A list of tables with `x`, `y`, `width` and
+ *  `height` keys, the only parts where the pattern differs from the current
+ *  wallpaper.
+ * @return A cairo surface or nothing when getting it, whether the wallpaper
+ *  is being set when setting it.
  * @deprecated wallpaper
  * @see awful.wallpaper
  */
 static int luaA_root_wallpaper(lua_State *L) {
-    if (lua_gettop(L) == 1) {
+    if (lua_gettop(L) >= 1) {
         /* Avoid `error()s` down the line. If this happens during
          * initialization, AwesomeWM can be stuck in an infinite loop */
-        if (lua_isnil(L, -1)) return 0;
-
-        cairo_pattern_t *pattern = (cairo_pattern_t *)lua_touserdata(L, -1);
-        lua_pushboolean(L, root_set_wallpaper(pattern));
+        if (lua_isnil(L, 1)) return 0;
+
+        cairo_pattern_t *pattern = (cairo_pattern_t *)lua_touserdata(L, 1);
+        area_t          *areas   = NULL;
+        int              count   = 0;
+        if (!lua_isnoneornil(L, 2)) {
+            luaL_checktype(L, 2, LUA_TTABLE);
+            count = luaL_len(L, 2);
+            /* Collected by Lua if an entry is invalid */
+            areas = lua_newuserdatauv(L, count * sizeof(area_t), 0);
+            for (int i = 0; i < count; i++) {
+                lua_rawgeti(L, 2, i + 1);
+                luaL_checktype(L, -1, LUA_TTABLE);
+                areas[i].x      = luaA_getopt_integer(L, -1, "x", 0);
+                areas[i].y      = luaA_getopt_integer(L, -1, "y", 0);
+                areas[i].width  = MAX(luaA_getopt_integer(L, -1, "width", 0), 0);
+                areas[i].height = MAX(luaA_getopt_integer(L, -1, "height", 0), 0);
+                lua_pop(L, 1);
+            }
+        }
+        lua_pushboolean(L, root_set_wallpaper(pattern, areas, count));
         /* Don't return the wallpaper, it's too easy to get memleaks */
         return 1;
     }
 
+    /* Lua wants to paint on top of the wallpaper it set last */
+    root_wallpaper_finish();
     if (globalconf.wallpaper == NULL) return 0;
 
     /* lua has to make sure this surface gets destroyed */
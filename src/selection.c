@@ -27,6 +27,7 @@
  */
 
 #include "selection.h"
+#include "awesome.h"
 #include "common/atoms.h"
 #include "common/lualib.h"
 #include "common/signals.h"
@@ -75,7 +76,7 @@ static int luaA_selection_get(lua_State *L) {
     xcb_generic_event_t *event;
 
     while (true) {
-        event = xcb_wait_for_event(globalconf.connection);
+        event = awesome_wait_for_event();
 
         if (!event) return 0;
 
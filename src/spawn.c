@@ -120,19 +120,14 @@ static void spawn_monitor_event(SnMonitorEvent *event, void *data) {
     lua_State         *L          = globalconf_get_lua_State();
     SnStartupSequence *sequence   = sn_monitor_event_get_startup_sequence(event);
     SnMonitorEventType event_type = sn_monitor_event_get_type(event);
-
-    lua_createtable(L, 0, 2);
-    lua_pushstring(L, sn_startup_sequence_get_id(sequence));
-    lua_setfield(L, -2, "id");
-
-    const char *event_type_str = NULL;
+    luna_signal_id_t   id         = 0;
 
     switch (event_type) {
         case SN_MONITOR_EVENT_INITIATED:
             /* ref the sequence for the array */
             sn_startup_sequence_ref(sequence);
             SnStartupSequence_array_append(&sn_waits, sequence);
-            event_type_str = ":spawn.initiated";
+            id = LUNA_SIGNAL(":spawn.initiated");
 
             /* Add a timeout function so we do not wait for this event to complete
              * for ever */
@@ -141,20 +136,23 @@ static void spawn_monitor_event(SnMonitorEvent *event, void *data) {
             sn_startup_sequence_ref(sequence);
             break;
         case SN_MONITOR_EVENT_CHANGED:
-            event_type_str = ":spawn.change";
+            id = LUNA_SIGNAL(":spawn.change");
             break;
         case SN_MONITOR_EVENT_COMPLETED:
-            event_type_str = ":spawn.completed";
+            id = LUNA_SIGNAL(":spawn.completed");
             break;
         case SN_MONITOR_EVENT_CANCELED:
-            event_type_str = ":spawn.canceled";
+            id = LUNA_SIGNAL(":spawn.canceled");
             break;
     }
 
-    /* common actions */
-    switch (event_type) {
-        case SN_MONITOR_EVENT_INITIATED:
-        case SN_MONITOR_EVENT_CHANGED: {
+    /* Only build the argument table if someone is listening */
+    if (luna_global_has_listeners(L, id)) {
+        lua_createtable(L, 0, 2);
+        lua_pushstring(L, sn_startup_sequence_get_id(sequence));
+        lua_setfield(L, -2, "id");
+
+        if (event_type == SN_MONITOR_EVENT_INITIATED || event_type == SN_MONITOR_EVENT_CHANGED) {
             const char *s = sn_startup_sequence_get_name(sequence);
             if (s) {
                 lua_pushstring(L, s);
@@ -183,15 +181,15 @@ static void spawn_monitor_event(SnMonitorEvent *event, void *data) {
                 lua_pushstring(L, s);
                 lua_setfield(L, -2, "wmclass");
             }
-        } break;
-        case SN_MONITOR_EVENT_COMPLETED:
-        case SN_MONITOR_EVENT_CANCELED:
-            spawn_sequence_remove(sequence);
-            break;
+        }
+
+        /* send the signal */
+        luna_emit_global_signal_id(L, id, 1);
     }
 
-    /* send the signal */
-    luna_emit_global_signal(L, event_type_str, 1);
+    /* The sequence may be freed here, so this comes after the table is built */
+    if (event_type == SN_MONITOR_EVENT_COMPLETED || event_type == SN_MONITOR_EVENT_CANCELED)
+        spawn_sequence_remove(sequence);
 }
 
 /** Tell the spawn module that an app has been started.
@@ -63,6 +63,11 @@ stack_client_append(client_t *c)
 
 static bool need_stack_refresh = false;
 
+/** The stacking order last sent to the X server, bottom window first */
+static window_array_t stack_sent;
+/** Number of restack requests sent by the last stack_refresh() */
+static int stack_last_restack_count = 0;
+
 void
 stack_windows(void)
 {
@@ -87,24 +92,133 @@ stack_window_above(xcb_window_t w, xcb_window_t previous)
                          (uint32_t[]) { previous, XCB_STACK_MODE_ABOVE });
 }
 
-/** Stack a client above.
- * \param c The client.
- * \param previous The previous client on the stack.
- * \return The next-previous!
+/** Stack a window below another window.
+ * \param w The window.
+ * \param next The window which should be above this window.
  */
-static xcb_window_t
-stack_client_above(client_t *c, xcb_window_t previous)
+static void
+stack_window_below(xcb_window_t w, xcb_window_t next)
 {
-    stack_window_above(c->frame_window, previous);
+    xcb_configure_window(globalconf.connection, w,
+                         XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE,
+                         (uint32_t[]) { next, XCB_STACK_MODE_BELOW });
+}
 
-    previous = c->frame_window;
+/** Add a client and its transients to a stacking order.
+ * \param c The client.
+ * \param order The stacking order, bottom window first.
+ * \param owners The client owning each window of the order, or NULL.
+ */
+static void
+stack_client_above(client_t *c, window_array_t *order, client_array_t *owners)
+{
+    c->stacking.position = order->len;
+    window_array_append(order, c->frame_window);
+    client_array_append(owners, c);
 
     /* stack transient window on top of their parents */
-    foreach(node, globalconf.stack)
-        if((*node)->transient_for == c)
-            previous = stack_client_above(*node, previous);
+    for(client_t *tc = c->stacking.transients; tc; tc = tc->stacking.sibling)
+        stack_client_above(tc, order, owners);
+}
+
+typedef struct
+{
+    xcb_window_t window;
+    int index;
+} stack_position_t;
+
+static int
+stack_position_cmp(const void *a, const void *b)
+{
+    const stack_position_t *x = a, *y = b;
+    return x->window > y->window ? 1 : (x->window < y->window ? -1 : 0);
+}
+
+/** Restack windows from the last order sent to the X server to a new one.
+ * The longest run of windows which are already in the right relative order
+ * is left alone, every other window is stacked right above its new
+ * predecessor.
+ * \param order The new stacking order, bottom window first.
+ * \return The number of restack requests sent.
+ */
+static int
+stack_apply(window_array_t *order)
+{
+    int n = order->len, count = 0, len = 0;
+
+    if(!n)
+        return 0;
+
+    /* Old positions by window */
+    stack_position_t *sent = p_new(stack_position_t, stack_sent.len + 1);
+    for(int i = 0; i < stack_sent.len; i++)
+        sent[i] = (stack_position_t) { stack_sent.tab[i], i };
+    qsort(sent, stack_sent.len, sizeof(*sent), stack_position_cmp);
+
+    int *pos = p_new(int, n);
+    int *tails = p_new(int, n);
+    int *prev = p_new(int, n);
+    bool *keep = p_new(bool, n);
+
+    for(int i = 0; i < n; i++)
+    {
+        stack_position_t key = { order->tab[i], 0 };
+        stack_position_t *found = bsearch(&key, sent, stack_sent.len, sizeof(*sent),
+                                          stack_position_cmp);
+        pos[i] = found ? found->index : -1;
+    }
+
+    /* Longest increasing subsequence of old positions, new windows are never
+     * part of it. tails[l] is the window ending the best subsequence of
+     * length l + 1 found so far. */
+    for(int i = 0; i < n; i++)
+    {
+        if(pos[i] < 0)
+            continue;
+
+        int lo = 0, hi = len;
+        while(lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if(pos[tails[mid]] < pos[i])
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        prev[i] = lo > 0 ? tails[lo - 1] : -1;
+        tails[lo] = i;
+        if(lo == len)
+            len++;
+    }
+    for(int i = len ? tails[len - 1] : -1; i >= 0; i = prev[i])
+        keep[i] = true;
+
+    /* The bottom window has no predecessor: put it under the lowest window
+     * staying in place. If nothing stays, leave it where it is; stacking it
+     * at the very bottom would make every other window redraw. */
+    if(!keep[0])
+        for(int i = 1; i < n; i++)
+            if(keep[i])
+            {
+                stack_window_below(order->tab[0], order->tab[i]);
+                count++;
+                break;
+            }
+
+    for(int i = 1; i < n; i++)
+        if(!keep[i])
+        {
+            stack_window_above(order->tab[i], order->tab[i - 1]);
+            count++;
+        }
+
+    p_delete(&sent);
+    p_delete(&pos);
+    p_delete(&tails);
+    p_delete(&prev);
+    p_delete(&keep);
 
-    return previous;
+    return count;
 }
 
 /** Stacking layout layers */
@@ -155,9 +269,58 @@ client_layer_translator(client_t *c)
     return WINDOW_LAYER_NORMAL;
 }
 
-/** Restack clients.
- * \todo It might be worth stopping to restack everyone and only stack `c'
- * relatively to the first matching in the list.
+/** Sort the client stack into per layer lists and link every client to the
+ * clients transient for it, in a single pass.
+ * \param layers The first client of each layer.
+ */
+static void
+stack_build_links(client_t *layers[WINDOW_LAYER_COUNT])
+{
+    static unsigned int generation = 0;
+    client_t *last[WINDOW_LAYER_COUNT] = { NULL };
+
+    generation++;
+
+    foreach(node, globalconf.stack)
+    {
+        client_t *c = *node;
+
+        if(c->stacking.generation != generation)
+        {
+            c->stacking.generation = generation;
+            c->stacking.transients = c->stacking.transients_last = NULL;
+        }
+        c->stacking.next = c->stacking.sibling = NULL;
+
+        if(c->transient_for)
+        {
+            client_t *parent = c->transient_for;
+
+            if(parent->stacking.generation != generation)
+            {
+                parent->stacking.generation = generation;
+                parent->stacking.transients = parent->stacking.transients_last = NULL;
+            }
+            if(parent->stacking.transients_last)
+                parent->stacking.transients_last->stacking.sibling = c;
+            else
+                parent->stacking.transients = c;
+            parent->stacking.transients_last = c;
+        }
+
+        window_layer_t layer = client_layer_translator(c);
+        if(layer == WINDOW_LAYER_IGNORE)
+            continue;
+        if(last[layer])
+            last[layer]->stacking.next = c;
+        else
+            layers[layer] = c;
+        last[layer] = c;
+    }
+}
+
+/** Restack clients and drawins.
+ * Only windows whose position changed since the last refresh are restacked.
  */
 void
 stack_refresh()
@@ -165,38 +328,66 @@ stack_refresh()
     if(!need_stack_refresh)
         return;
 
-    xcb_window_t next = XCB_NONE;
+    client_t *layers[WINDOW_LAYER_COUNT] = { NULL };
+    window_array_t order;
+    client_array_t owners;
+    window_array_init(&order);
+    client_array_init(&owners);
+
+    stack_build_links(layers);
 
     /* stack desktop windows */
     for(window_layer_t layer = WINDOW_LAYER_DESKTOP; layer < WINDOW_LAYER_BELOW; layer++)
-        foreach(node, globalconf.stack)
-            if(client_layer_translator(*node) == layer)
-                next = stack_client_above(*node, next);
+        for(client_t *c = layers[layer]; c; c = c->stacking.next)
+            stack_client_above(c, &order, &owners);
 
     /* first stack not ontop drawin window */
     foreach(drawin, globalconf.drawins)
         if(!(*drawin)->ontop)
         {
-            stack_window_above((*drawin)->window, next);
-            next = (*drawin)->window;
+            window_array_append(&order, (*drawin)->window);
+            client_array_append(&owners, NULL);
         }
 
     /* then stack clients */
     for(window_layer_t layer = WINDOW_LAYER_BELOW; layer < WINDOW_LAYER_COUNT; layer++)
-        foreach(node, globalconf.stack)
-            if(client_layer_translator(*node) == layer)
-                next = stack_client_above(*node, next);
+        for(client_t *c = layers[layer]; c; c = c->stacking.next)
+            stack_client_above(c, &order, &owners);
 
     /* then stack ontop drawin window */
     foreach(drawin, globalconf.drawins)
         if((*drawin)->ontop)
         {
-            stack_window_above((*drawin)->window, next);
-            next = (*drawin)->window;
+            window_array_append(&order, (*drawin)->window);
+            client_array_append(&owners, NULL);
         }
 
+    /* A transient with a layer of its own is reached both from its layer and
+     * from its parent. Only its last position counts, as it did back when
+     * each of them was sent to the X server. */
+    int len = 0;
+    for(int i = 0; i < order.len; i++)
+        if(!owners.tab[i] || owners.tab[i]->stacking.position == i)
+            order.tab[len++] = order.tab[i];
+    order.len = len;
+    client_array_wipe(&owners);
+
+    stack_last_restack_count = stack_apply(&order);
+
+    window_array_wipe(&stack_sent);
+    stack_sent = order;
+
     need_stack_refresh = false;
 }
 
+/** Get the number of restack requests sent by the last stack refresh.
+ * \return The number of ConfigureWindow requests.
+ */
+int
+stack_restack_count(void)
+{
+    return stack_last_restack_count;
+}
+
 
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
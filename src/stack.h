@@ -29,6 +29,7 @@ void stack_client_push(client_t *);
 void stack_client_append(client_t *);
 void stack_windows(void);
 void stack_refresh(void);
+int stack_restack_count(void);
 
 #endif
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -28,6 +28,7 @@
 #include "common/xutil.h"
 #include "globalconf.h"
 #include "objects/drawin.h"
+#include "winreg.h"
 #include "xwindow.h"
 
 #include <xcb/xcb.h>
@@ -122,7 +123,7 @@ int systray_request_handle(xcb_window_t embed_win) {
         XCB_EVENT_MASK_ENTER_WINDOW};
 
     /* check if not already trayed */
-    if (xembed_getbywin(&globalconf.embedded, embed_win)) return -1;
+    if (systray_getbywin(embed_win)) return -1;
 
     p_clear(&em_cookie, 1);
 
@@ -150,11 +151,42 @@ int systray_request_handle(xcb_window_t embed_win) {
         MIN(XEMBED_VERSION, em.info.version));
 
     xembed_window_array_append(&globalconf.embedded, em);
+    winreg_insert(em.win, WINREG_XEMBED, NULL);
     luaA_systray_invalidate();
 
     return 0;
 }
 
+/** Get an embedded systray window.
+ * \param win The window.
+ * \return The embedded window if found, NULL otherwise.
+ */
+xembed_window_t *systray_getbywin(xcb_window_t win) {
+    /* The registry only tells us whether the window is embedded, since
+     * entries move around inside globalconf.embedded. */
+    if (winreg_kind(win) != WINREG_XEMBED) return NULL;
+
+    return xembed_getbywin(&globalconf.embedded, win);
+}
+
+/** Stop tracking an embedded systray window.
+ * \param win The window.
+ * \return True if the window was embedded.
+ */
+bool systray_remove(xcb_window_t win) {
+    if (winreg_kind(win) != WINREG_XEMBED) return false;
+
+    winreg_remove(win);
+    for (int i = 0; i < globalconf.embedded.len; i++)
+        if (globalconf.embedded.tab[i].win == win) {
+            xembed_window_array_take(&globalconf.embedded, i);
+            luaA_systray_invalidate();
+            return true;
+        }
+
+    return false;
+}
+
 /** Handle systray message.
  * \param ev The event.
  * \return 0 on no error.
@@ -180,21 +212,26 @@ int systray_process_client_message(xcb_client_message_event_t *ev) {
     return ret;
 }
 
-/** Check if a window is a KDE tray.
+/** Send request to check if a window is a KDE tray.
  * \param w The window to check.
- * \return True if it is, false otherwise.
+ * \return The cookie associated with the request.
  */
-bool systray_iskdedockapp(xcb_window_t w) {
-    xcb_get_property_cookie_t kde_check_q;
-    xcb_get_property_reply_t *kde_check;
-    bool                      ret;
-
+xcb_get_property_cookie_t systray_kdedockapp_get_unchecked(xcb_window_t w) {
     /* Check if that is a KDE tray because it does not respect fdo standards,
      * thanks KDE. */
-    kde_check_q = xcb_get_property_unchecked(
+    return xcb_get_property_unchecked(
         globalconf.connection, false, w, _KDE_NET_WM_SYSTEM_TRAY_WINDOW_FOR, XCB_ATOM_WINDOW, 0, 1);
+}
+
+/** Check if a window is a KDE tray.
+ * \param cookie Cookie from systray_kdedockapp_get_unchecked().
+ * \return True if it is, false otherwise.
+ */
+bool systray_iskdedockapp(xcb_get_property_cookie_t cookie) {
+    xcb_get_property_reply_t *kde_check;
+    bool                      ret;
 
-    kde_check = xcb_get_property_reply(globalconf.connection, kde_check_q, NULL);
+    kde_check = xcb_get_property_reply(globalconf.connection, cookie, NULL);
 
     /* it's a KDE systray ?*/
     ret       = (kde_check && kde_check->value_len);
@@ -26,14 +26,17 @@
 #include <xcb/xcb.h>
 #include "common/xembed.h"
 
-void systray_init(void);
-void systray_cleanup(void);
-int  systray_request_handle(xcb_window_t);
-bool systray_iskdedockapp(xcb_window_t);
-int  systray_process_client_message(xcb_client_message_event_t *);
-int  xembed_process_client_message(xcb_client_message_event_t *);
-int  luaA_systray(lua_State *);
-void luaA_systray_invalidate(void);
+void                      systray_init(void);
+void                      systray_cleanup(void);
+int                       systray_request_handle(xcb_window_t);
+xembed_window_t          *systray_getbywin(xcb_window_t);
+bool                      systray_remove(xcb_window_t);
+xcb_get_property_cookie_t systray_kdedockapp_get_unchecked(xcb_window_t);
+bool                      systray_iskdedockapp(xcb_get_property_cookie_t);
+int                       systray_process_client_message(xcb_client_message_event_t *);
+int                       xembed_process_client_message(xcb_client_message_event_t *);
+int                       luaA_systray(lua_State *);
+void                      luaA_systray_invalidate(void);
 
 #endif
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,171 @@
+/*
+ * winreg.c - window to object registry
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* Almost every X event has to be mapped back to the object owning the window
+ * it was delivered to. This is an open addressing hash table with linear
+ * probing keyed by window id, so those lookups don't depend on the number of
+ * managed windows. XCB_NONE marks an empty slot. */
+
+#include "winreg.h"
+#include "common/util.h"
+
+#define WINREG_MIN_SIZE 64
+
+typedef struct {
+    xcb_window_t  window;
+    winreg_kind_t kind;
+    void         *object;
+} winreg_entry_t;
+
+static struct {
+    winreg_entry_t *tab;
+    /** Number of used slots */
+    int len;
+    /** Number of slots, always a power of two */
+    int size;
+} winreg;
+
+static inline uint32_t winreg_hash(xcb_window_t w) {
+    /* Window ids are handed out sequentially from the client's resource base,
+     * scatter them with a Fibonacci multiplier. */
+    uint32_t h = w * 2654435769u;
+    return h ^ (h >> 16);
+}
+
+/** Find the slot of a window, or the empty slot where it would go.
+ * \param w The window.
+ * \return A slot index.
+ */
+static int winreg_slot(xcb_window_t w) {
+    int mask = winreg.size - 1;
+    int i    = winreg_hash(w) & mask;
+
+    while (winreg.tab[i].window != XCB_NONE && winreg.tab[i].window != w)
+        i = (i + 1) & mask;
+
+    return i;
+}
+
+static void winreg_resize(int size) {
+    winreg_entry_t *old      = winreg.tab;
+    int             old_size = winreg.size;
+
+    winreg.tab  = p_new(winreg_entry_t, size);
+    winreg.size = size;
+
+    for (int i = 0; i < old_size; i++)
+        if (old[i].window != XCB_NONE) winreg.tab[winreg_slot(old[i].window)] = old[i];
+
+    p_delete(&old);
+}
+
+/** Register a window.
+ * \param w The window.
+ * \param kind What the window is used for.
+ * \param object The object owning the window.
+ */
+void winreg_insert(xcb_window_t w, winreg_kind_t kind, void *object) {
+    if (w == XCB_NONE) return;
+
+    /* Keep the load factor under one half so probe sequences stay short. */
+    if ((winreg.len + 1) * 2 > winreg.size)
+        winreg_resize(winreg.size ? winreg.size * 2 : WINREG_MIN_SIZE);
+
+    winreg_entry_t *entry = &winreg.tab[winreg_slot(w)];
+
+    if (entry->window == XCB_NONE) winreg.len++;
+
+    entry->window = w;
+    entry->kind   = kind;
+    entry->object = object;
+}
+
+/** Unregister a window.
+ * \param w The window.
+ */
+void winreg_remove(xcb_window_t w) {
+    if (w == XCB_NONE || !winreg.len) return;
+
+    int mask = winreg.size - 1;
+    int i    = winreg_slot(w);
+
+    if (winreg.tab[i].window == XCB_NONE) return;
+
+    winreg.len--;
+
+    /* Backward shift deletion: move later entries of the same probe sequence
+     * into the hole so lookups never need tombstones. */
+    for (int j = i;;) {
+        winreg.tab[i].window = XCB_NONE;
+
+        for (;;) {
+            j = (j + 1) & mask;
+
+            if (winreg.tab[j].window == XCB_NONE) return;
+
+            int k = winreg_hash(winreg.tab[j].window) & mask;
+
+            /* Leave the entry where it is if its home slot lies cyclically in
+             * (i, j], moving it would make it unreachable. */
+            if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+
+            break;
+        }
+
+        winreg.tab[i] = winreg.tab[j];
+        i             = j;
+    }
+}
+
+/** Get the object owning a window.
+ * \param w The window.
+ * \param kind The kind of window expected.
+ * \return The object, or NULL if the window is unknown or of another kind.
+ */
+void *winreg_lookup(xcb_window_t w, winreg_kind_t kind) {
+    if (w == XCB_NONE || !winreg.len) return NULL;
+
+    winreg_entry_t *entry = &winreg.tab[winreg_slot(w)];
+
+    return entry->window == w && entry->kind == kind ? entry->object : NULL;
+}
+
+/** Get the kind of a registered window.
+ * \param w The window.
+ * \return The kind, or WINREG_NONE if the window is unknown.
+ */
+winreg_kind_t winreg_kind(xcb_window_t w) {
+    if (w == XCB_NONE || !winreg.len) return WINREG_NONE;
+
+    winreg_entry_t *entry = &winreg.tab[winreg_slot(w)];
+
+    return entry->window == w ? entry->kind : WINREG_NONE;
+}
+
+/** Free the registry.
+ */
+void winreg_wipe(void) {
+    p_delete(&winreg.tab);
+    winreg.len  = 0;
+    winreg.size = 0;
+}
+
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,49 @@
+/*
+ * winreg.h - window to object registry header
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AWESOME_WINREG_H
+#define AWESOME_WINREG_H
+
+#include <xcb/xcb.h>
+
+/** What a registered window belongs to. */
+typedef enum {
+    WINREG_NONE = 0,
+    /** The client's own window */
+    WINREG_CLIENT,
+    /** The frame window we reparent clients into (titlebars are drawn here) */
+    WINREG_CLIENT_FRAME,
+    /** The hidden window used to focus clients that refuse input focus */
+    WINREG_CLIENT_NOFOCUS,
+    /** A mapped drawin */
+    WINREG_DRAWIN,
+    /** A systray icon, the object is always NULL */
+    WINREG_XEMBED,
+} winreg_kind_t;
+
+void          winreg_insert(xcb_window_t, winreg_kind_t, void *);
+void          winreg_remove(xcb_window_t);
+void         *winreg_lookup(xcb_window_t, winreg_kind_t);
+winreg_kind_t winreg_kind(xcb_window_t);
+void          winreg_wipe(void);
+
+#endif
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -16,6 +16,7 @@ local GLib = lgi.require('GLib')
 local Gdk  = lgi.require('Gdk')
 local Gtk  = lgi.require('Gtk', '3.0')
 local Gio  = lgi.require('Gio')
+local GdkPixbuf = lgi.require('GdkPixbuf')
 Gtk.init()
 
 local function open_window(class, title, options)
@@ -45,6 +46,16 @@ local function open_window(class, title, options)
     elseif options.unminimize_after then
         window:iconify()
     end
+    if options.icon_sizes then
+        local icons = {}
+        for size in string.gmatch(options.icon_sizes, "%d+") do
+            size = tonumber(size)
+            local icon = GdkPixbuf.Pixbuf.new(GdkPixbuf.Colorspace.RGB, true, 8, size, size)
+            icon:fill(0xff0000ff)
+            table.insert(icons, icon)
+        end
+        window:set_icon_list(icons)
+    end
     window:set_wmclass(class, class)
     window:show_all()
     if options.maximize_after then
@@ -213,6 +224,9 @@ local function new(_, class, title, sn_rules, callback, resize_increment, args)
             args.resize.height, ","
         }
     end
+    if args.icon_sizes then
+        options = options .. "icon_sizes=" .. table.concat(args.icon_sizes, ":") .. ","
+    end
     if args.gravity then
         assert(type(args.gravity)=="number","Use `lgi.Gdk.Gravity.NORTH_WEST`")
         options = options .. "gravity=" .. args.gravity .. ","
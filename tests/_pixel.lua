@@ -0,0 +1,27 @@
+-- Helper to check what was drawn where
+
+local gsurface = require("gears.surface")
+local lgi = require("lgi")
+local cairo = lgi.cairo
+local gdk = lgi.require("Gdk", "3.0")
+
+local module = {}
+
+--- Get the color of a pixel of a surface, like "#ff0000".
+-- @param surf The surface, for example `root.content()`.
+-- @tparam number x The x coordinate of the pixel.
+-- @tparam number y The y coordinate of the pixel.
+function module.get_pixel(surf, x, y)
+    local img = cairo.ImageSurface(cairo.Format.RGB24, 1, 1)
+    local cr = cairo.Context(img)
+    cr:set_source_surface(gsurface(surf), -x, -y)
+    cr:paint()
+    img:flush()
+
+    local bytes = gdk.pixbuf_get_from_surface(img, 0, 0, 1, 1):get_pixels()
+    return "#" .. bytes:gsub(".", function(c) return ("%02x"):format(c:byte()) end)
+end
+
+return module
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
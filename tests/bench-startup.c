@@ -0,0 +1,188 @@
+/*
+ * A benchmark for managing pre-existing windows at startup.
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_aux.h>
+#include <xcb/xcb_icccm.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * This program measures how long the window manager takes to manage windows
+ * which already exist when it starts. It must be run on an X server without a
+ * window manager, for example:
+ *
+ *   Xvfb :5 &
+ *   DISPLAY=:5 ./bench-startup 500 ./awesome -c rc.lua
+ *
+ * It does:
+ * - Create and map the given number of windows, each with the usual ICCCM
+ *   and EWMH properties set.
+ * - Start the window manager with the remaining arguments.
+ * [Wait for all windows to be reparented]
+ * - Print the time from starting the window manager until the last window
+ *   got reparented, then stop the window manager.
+ *
+ * The time includes loading the configuration, so use a minimal one.
+ */
+
+#define TIMEOUT_MS 60000
+
+static xcb_connection_t *c = NULL;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static xcb_atom_t intern_atom(const char *name)
+{
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(c,
+            xcb_intern_atom(c, 0, strlen(name), name), NULL);
+    xcb_atom_t atom = reply ? reply->atom : XCB_NONE;
+
+    free(reply);
+    return atom;
+}
+
+static void create_windows(xcb_screen_t *screen, int count)
+{
+    xcb_atom_t net_wm_name = intern_atom("_NET_WM_NAME");
+    xcb_atom_t net_wm_pid = intern_atom("_NET_WM_PID");
+    xcb_atom_t utf8_string = intern_atom("UTF8_STRING");
+    uint32_t pid = getpid();
+    uint32_t mask = XCB_CW_EVENT_MASK;
+    uint32_t values[] = { XCB_EVENT_MASK_STRUCTURE_NOTIFY };
+    char name[32];
+
+    for (int i = 0; i < count; i++) {
+        xcb_window_t win = xcb_generate_id(c);
+        int len = snprintf(name, sizeof(name), "bench-startup %d", i);
+
+        xcb_create_window(c, XCB_COPY_FROM_PARENT, win, screen->root,
+                (i * 7) % 800, (i * 11) % 600, 100, 100, 0,
+                XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+                mask, values);
+        xcb_icccm_set_wm_name(c, win, XCB_ATOM_STRING, 8, len, name);
+        xcb_change_property(c, XCB_PROP_MODE_REPLACE, win, net_wm_name,
+                utf8_string, 8, len, name);
+        xcb_icccm_set_wm_class(c, win, sizeof("bench\0Bench"), "bench\0Bench");
+        xcb_change_property(c, XCB_PROP_MODE_REPLACE, win, net_wm_pid,
+                XCB_ATOM_CARDINAL, 32, 1, &pid);
+        xcb_map_window(c, win);
+    }
+
+    xcb_aux_sync(c);
+}
+
+static pid_t start_wm(char **argv)
+{
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        execvp(argv[0], argv);
+        fprintf(stderr, "Failed to run %s: %s\n", argv[0], strerror(errno));
+        _exit(1);
+    }
+    if (pid < 0) {
+        fprintf(stderr, "fork failed: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    return pid;
+}
+
+static bool wait_for_reparents(int count)
+{
+    struct pollfd pfd = { .fd = xcb_get_file_descriptor(c), .events = POLLIN };
+    xcb_generic_event_t *ev;
+    int reparented = 0;
+
+    while (reparented < count) {
+        while ((ev = xcb_poll_for_event(c)) != NULL) {
+            if ((ev->response_type & 0x7f) == XCB_REPARENT_NOTIFY)
+                reparented++;
+            free(ev);
+        }
+        if (reparented >= count)
+            break;
+        if (xcb_connection_has_error(c)) {
+            fprintf(stderr, "X connection broke\n");
+            return false;
+        }
+        if (poll(&pfd, 1, TIMEOUT_MS) <= 0) {
+            fprintf(stderr, "Timed out, only %d of %d windows got managed\n",
+                    reparented, count);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int screen_no, count;
+    xcb_screen_t *screen;
+    double start, end;
+    pid_t pid;
+    bool ok;
+
+    if (argc < 3 || (count = atoi(argv[1])) <= 0) {
+        fprintf(stderr, "Usage: %s <windows> <window manager> [args...]\n", argv[0]);
+        return 1;
+    }
+
+    c = xcb_connect(NULL, &screen_no);
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "Failed to connect to the X server\n");
+        return 1;
+    }
+    screen = xcb_aux_get_screen(c, screen_no);
+
+    create_windows(screen, count);
+
+    start = now();
+    pid = start_wm(&argv[2]);
+    ok = wait_for_reparents(count);
+    end = now();
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    xcb_disconnect(c);
+
+    if (!ok)
+        return 1;
+
+    printf("%d windows managed in %.3f ms\n", count, (end - start) * 1e3);
+    return 0;
+}
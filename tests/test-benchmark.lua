@@ -66,6 +66,26 @@ local function update_textclock()
     do_pending_repaint()
 end
 
+local moving_wibox = create_wibox()
+
+-- Each move emits ":property.geometry" and ":property.x" from the C core, with
+-- wibox forwarding them to Lua listeners.
+local function move_wibox()
+    moving_wibox.x = moving_wibox.x == 0 and 1 or 0
+end
+
+-- Reads of C properties, own and inherited from Window, like the ones
+-- tasklists and rules do all the time.
+local property_drawin = moving_wibox.drawin
+local function read_properties()
+    local d = property_drawin
+    local x, visible, ontop, window
+    for _ = 1, 250000 do
+        x, visible, ontop, window = d.x, d.visible, d.ontop, d.window
+    end
+    return x, visible, ontop, window
+end
+
 local function e2e_tag_switch()
     awful.tag.viewnext()
     do_pending_repaint()
@@ -76,6 +96,8 @@ benchmark(update_textclock, "update textclock")
 benchmark(relayout_textclock, "relayout textclock")
 benchmark(redraw_textclock, "redraw textclock")
 benchmark(e2e_tag_switch, "tag switch")
+benchmark(move_wibox, "move wibox")
+benchmark(read_properties, "1M property reads")
 
 runner.run_steps({ function() return true end })
 
@@ -0,0 +1,76 @@
+-- Test reading client icons from _NET_WM_ICON
+
+local runner = require("_runner")
+local test_client = require("_client")
+local gears = require("gears")
+
+local c
+
+local steps = {
+    function()
+        test_client("icon_test", nil, nil, nil, nil, { icon_sizes = { 16, 32, 48 } })
+        return true
+    end,
+
+    function()
+        c = client.get()[1]
+        if not c or #c.icon_sizes == 0 then return end
+
+        local sizes = c.icon_sizes
+        assert(#sizes == 3, #sizes)
+        for i, size in ipairs { 16, 32, 48 } do
+            assert(sizes[i][1] == size and sizes[i][2] == size, i)
+        end
+
+        return true
+    end,
+
+    -- Only the image closest to the preferred size is read
+    function()
+        awesome.set_preferred_icon_size(30)
+        local icon = gears.surface(c.icon)
+        assert(icon:get_width() == 32, icon:get_width())
+
+        awesome.set_preferred_icon_size(100)
+        icon = gears.surface(c.icon)
+        assert(icon:get_width() == 48, icon:get_width())
+
+        icon = gears.surface(c:get_icon(1))
+        assert(icon:get_width() == 16, icon:get_width())
+
+        return true
+    end,
+
+    -- Scaled icons are cached per size
+    function()
+        local a, b = c:get_scaled_icon(24, 24), c:get_scaled_icon(24, 24)
+        assert(a == b)
+        local other = c:get_scaled_icon(20, 10)
+        assert(other ~= a)
+
+        a, b, other = gears.surface(a), gears.surface(b), gears.surface(other)
+        assert(a:get_width() == 24 and a:get_height() == 24)
+        assert(other:get_width() == 10 and other:get_height() == 10)
+
+        return true
+    end,
+
+    -- Setting an icon from Lua replaces the ones from _NET_WM_ICON and drops
+    -- the scaled ones
+    function()
+        local before = c:get_scaled_icon(24, 24)
+        c.icon = gears.surface(c:get_icon(2))._native
+        assert(#c.icon_sizes == 1)
+        assert(c.icon_sizes[1][1] == 32)
+
+        local after = c:get_scaled_icon(24, 24)
+        assert(after ~= before)
+        gears.surface(before)
+        gears.surface(after)
+        return true
+    end,
+}
+
+runner.run_steps(steps)
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
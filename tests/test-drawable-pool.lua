@@ -0,0 +1,52 @@
+-- Test that drawable resizes reuse pooled pixmaps
+
+local runner = require("_runner")
+
+local w = drawin {
+    x = 10,
+    y = 10,
+    width = 100,
+    height = 100,
+}
+
+local function resize(width, expect)
+    local before = awesome.drawable_pool
+    w.width = width
+    local after = awesome.drawable_pool
+
+    assert(w.drawable.surface)
+    assert(after.bytes <= after.limit)
+    if expect == "hit" then
+        assert(after.hits == before.hits + 1, after.hits)
+        assert(after.misses == before.misses, after.misses)
+    else
+        assert(after.hits == before.hits, after.hits)
+        assert(after.misses == before.misses + 1, after.misses)
+    end
+end
+
+runner.run_steps({
+    function()
+        -- Small changes fit into the pixmap of the current size class
+        resize(110, "hit")
+        resize(100, "hit")
+
+        -- Growing out of it needs a new pixmap, the old one is pooled
+        resize(300, "miss")
+        assert(awesome.drawable_pool.pixmaps >= 1)
+
+        -- Going back reuses the pooled pixmap, not the much bigger one
+        resize(100, "hit")
+
+        -- Without a pool every resize creates a pixmap
+        awesome.set_drawable_pool_limit(0)
+        assert(awesome.drawable_pool.pixmaps == 0)
+        assert(awesome.drawable_pool.bytes == 0)
+        resize(110, "miss")
+
+        awesome.set_drawable_pool_limit(16 * 1024 * 1024)
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,110 @@
+-- Test that pseudo-transparent drawables get the wallpaper from the X server
+-- and that only the ones in front of a changed area are told
+
+local runner = require("_runner")
+local get_pixel = require("_pixel").get_pixel
+local color = require("gears.color")
+local gsurface = require("gears.surface")
+local lgi = require("lgi")
+local cairo = lgi.cairo
+
+-- The wallpaper::changed arguments each drawin got
+local changes = {}
+
+local function make_drawin(x, y)
+    local w = drawin {
+        x = x,
+        y = y,
+        width = 20,
+        height = 20,
+        visible = true,
+    }
+    w.drawable.pseudo_transparent = true
+    changes[w] = {}
+    w.drawable:connect_signal("wallpaper::changed", function(_, ...)
+        table.insert(changes[w], { ... })
+    end)
+    return w
+end
+
+local changed = false
+awesome.connect_signal("wallpaper_changed", function() changed = true end)
+
+local near, far
+
+runner.run_steps({
+    function()
+        assert(root.wallpaper(color("#ff0000")))
+        return true
+    end,
+
+    function()
+        if not changed then return end
+
+        near = make_drawin(10, 10)
+        far = make_drawin(200, 200)
+
+        -- Without the flag Lua has to paint the wallpaper itself
+        local plain = drawin { width = 10, height = 10 }
+        assert(not plain.drawable:draw_wallpaper())
+
+        assert(near.drawable:draw_wallpaper())
+        near.drawable:refresh()
+        return true
+    end,
+
+    function()
+        if get_pixel(root.content(), 15, 15) ~= "#ff0000" then return end
+
+        -- Only the given rectangles are filled
+        local cr = cairo.Context(gsurface(near.drawable.surface))
+        cr:set_source_rgb(0, 0, 1)
+        cr:paint()
+        assert(near.drawable:draw_wallpaper {
+            { x = 0, y = 0, width = 5, height = 5 },
+        })
+        near.drawable:refresh()
+        return true
+    end,
+
+    function()
+        if get_pixel(root.content(), 12, 12) ~= "#ff0000" then return end
+        assert(get_pixel(root.content(), 25, 25) == "#0000ff")
+
+        -- Changing the top left corner only concerns the drawin there
+        changed = false
+        changes[near], changes[far] = {}, {}
+        assert(root.wallpaper(color("#00ff00"), {
+            { x = 0, y = 0, width = 20, height = 20 },
+        }))
+        return true
+    end,
+
+    function()
+        if not changed then return end
+
+        assert(#changes[near] == 1)
+        local x, y, width, height = table.unpack(changes[near][1])
+        assert(x == 0 and y == 0 and width == 10 and height == 10)
+        assert(#changes[far] == 0)
+
+        -- Without areas everything changed
+        changed = false
+        changes[near], changes[far] = {}, {}
+        near.drawable.pseudo_transparent = false
+        assert(root.wallpaper(color("#0000ff")))
+        return true
+    end,
+
+    function()
+        if not changed then return end
+
+        assert(#changes[near] == 0)
+        assert(#changes[far] == 1)
+        local x, y, width, height = table.unpack(changes[far][1])
+        assert(x == 0 and y == 0 and width == 20 and height == 20)
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
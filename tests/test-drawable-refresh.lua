@@ -0,0 +1,64 @@
+-- Test that Drawable:refresh only copies the given rectangles to the screen
+
+local runner = require("_runner")
+local get_pixel = require("_pixel").get_pixel
+local gsurface = require("gears.surface")
+local lgi = require("lgi")
+local cairo = lgi.cairo
+
+local w = drawin {
+    x = 10,
+    y = 10,
+    width = 20,
+    height = 20,
+    visible = true,
+}
+
+local function fill(r, g, b)
+    local cr = cairo.Context(gsurface(w.drawable.surface))
+    cr:set_source_rgb(r, g, b)
+    cr:paint()
+end
+
+runner.run_steps({
+    function()
+        fill(1, 0, 0)
+        w.drawable:refresh()
+        return true
+    end,
+
+    function()
+        if get_pixel(root.content(), 15, 15) ~= "#ff0000" then return end
+        assert(get_pixel(root.content(), 25, 25) == "#ff0000")
+
+        -- Only the top left quarter gets copied, the rest is out of range
+        fill(0, 0, 1)
+        w.drawable:refresh {
+            { x = 0, y = 0, width = 10, height = 10 },
+            { x = -5, y = 30, width = 10, height = 10 },
+            { x = 5, y = 5, width = 0, height = 100 },
+        }
+        return true
+    end,
+
+    function()
+        if get_pixel(root.content(), 15, 15) ~= "#0000ff" then return end
+        assert(get_pixel(root.content(), 25, 25) == "#ff0000")
+        assert(get_pixel(root.content(), 25, 15) == "#ff0000")
+
+        -- Without rectangles everything is copied
+        w.drawable:refresh()
+        return true
+    end,
+
+    function()
+        if get_pixel(root.content(), 25, 25) ~= "#0000ff" then return end
+
+        w.drawable:refresh {}
+        assert(not pcall(w.drawable.refresh, w.drawable, 42))
+        assert(not pcall(w.drawable.refresh, w.drawable, { 42 }))
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
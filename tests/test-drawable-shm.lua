@@ -0,0 +1,111 @@
+-- Test drawing into MIT-SHM segments and compare the speed with pixmaps
+
+local runner = require("_runner")
+local get_pixel = require("_pixel").get_pixel
+local gsurface = require("gears.surface")
+local lgi = require("lgi")
+local cairo = lgi.cairo
+local glib = lgi.GLib
+
+local FRAMES = 200
+
+local supported = awesome.set_drawable_shm(true)
+local w = drawin {
+    x = 10,
+    y = 10,
+    width = 400,
+    height = 100,
+    visible = true,
+}
+awesome.set_drawable_shm(false)
+
+local function fill(r, g, b)
+    local cr = cairo.Context(gsurface(w.drawable.surface))
+    cr:set_source_rgb(r, g, b)
+    cr:paint()
+    w.drawable:refresh()
+end
+
+-- Something like a wibar full of text and gradients
+local function draw_frame(i)
+    local cr = cairo.Context(gsurface(w.drawable.surface))
+    local pattern = cairo.LinearPattern(0, 0, 400, 0)
+    pattern:add_color_stop_rgb(0, (i % 10) / 10, 0, 0)
+    pattern:add_color_stop_rgb(1, 0, 0, 1)
+    cr:set_source(pattern)
+    cr:paint()
+
+    cr:set_source_rgb(1, 1, 1)
+    cr:set_font_size(12)
+    for line = 1, 6 do
+        cr:move_to(5, line * 15)
+        cr:show_text("Frame " .. i .. ": the quick brown fox jumps over the lazy dog")
+    end
+    w.drawable:refresh()
+end
+
+local function bench(name)
+    local start = glib.get_monotonic_time()
+    for i = 1, FRAMES do
+        draw_frame(i)
+    end
+    awesome.sync()
+    print(string.format("%-6s: %.3f ms/frame",
+        name, (glib.get_monotonic_time() - start) / 1e3 / FRAMES))
+end
+
+runner.run_steps({
+    function()
+        assert(w.drawable.shm == supported)
+        if not supported then
+            print("MIT-SHM is not supported, only the fallback is tested")
+        end
+
+        fill(1, 0, 0)
+        return true
+    end,
+
+    function()
+        if get_pixel(root.content(), 15, 15) ~= "#ff0000" then return end
+
+        -- Switching the backend replaces the surface
+        local surface_changed = false
+        w.drawable:connect_signal("property::surface", function()
+            surface_changed = true
+        end)
+        w.drawable.shm = false
+        assert(surface_changed)
+        assert(not w.drawable.shm)
+
+        fill(0, 1, 0)
+        return true
+    end,
+
+    function()
+        if get_pixel(root.content(), 15, 15) ~= "#00ff00" then return end
+
+        bench("pixmap")
+        w.drawable.shm = true
+        assert(w.drawable.shm == supported)
+        bench("shm")
+
+        -- Only the given area gets copied to the screen
+        fill(0, 0, 1)
+        local cr = cairo.Context(gsurface(w.drawable.surface))
+        cr:set_source_rgb(1, 0, 0)
+        cr:paint()
+        w.drawable:refresh { { x = 0, y = 0, width = 10, height = 10 } }
+        return true
+    end,
+
+    function()
+        if get_pixel(root.content(), 15, 15) ~= "#ff0000" then return end
+        assert(get_pixel(root.content(), 100, 50) == "#0000ff")
+
+        -- New drawables draw into pixmaps again
+        assert(not drawin({ width = 10, height = 10 }).drawable.shm)
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
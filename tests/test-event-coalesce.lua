@@ -0,0 +1,54 @@
+-- Test that the pointer passing through a drawin within one batch of events
+-- does not emit mouse::enter and mouse::leave
+
+local runner = require("_runner")
+
+local CROSSINGS = 10
+
+local w = drawin {
+    x = 100,
+    y = 100,
+    width = 20,
+    height = 20,
+    visible = true,
+}
+
+local entered, left, before = 0, 0, nil
+w.drawable:connect_signal("mouse::enter", function() entered = entered + 1 end)
+w.drawable:connect_signal("mouse::leave", function() left = left + 1 end)
+
+runner.run_steps({
+    function()
+        mouse.coords({ x = 50, y = 50 })
+        return true
+    end,
+
+    function()
+        before = awesome._coalesce_count
+        assert(before.configure_request and before.expose and before.enter_leave)
+
+        for _ = 1, CROSSINGS do
+            mouse.coords({ x = 110, y = 110 })
+            mouse.coords({ x = 50, y = 50 })
+        end
+        return true
+    end,
+
+    function(count)
+        local dropped = awesome._coalesce_count.enter_leave - before.enter_leave
+
+        -- Every crossing is either handled or dropped as a whole
+        if entered + dropped / 2 < CROSSINGS then
+            if count < 10 then return end
+            error(string.format("%d crossings handled, %d events dropped", entered, dropped))
+        end
+        assert(entered == left, left)
+        assert(entered + dropped / 2 == CROSSINGS, entered)
+
+        -- Usually all of them end up in one batch
+        print(string.format("%d of %d crossings dropped", dropped / 2, CROSSINGS))
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,47 @@
+-- Measure handling a storm of PropertyNotify events which all emit signals on
+-- drawins and on the global signal store
+
+local runner = require("_runner")
+
+local EVENTS = 2000
+
+local w = drawin {
+    x = 10,
+    y = 10,
+    width = 10,
+    height = 10,
+    visible = true,
+}
+
+local on_drawin, on_root = 0, 0
+
+awesome.register_xproperty("_TEST_EVENT_STORM", "number")
+w:connect_signal("xproperty::_TEST_EVENT_STORM", function() on_drawin = on_drawin + 1 end)
+awesome.connect_signal("xproperty::_TEST_EVENT_STORM", function() on_root = on_root + 1 end)
+
+runner.run_steps({
+    function()
+        awesome.loop_stats(true)
+        for i = 1, EVENTS / 2 do
+            w:set_xproperty("_TEST_EVENT_STORM", i)
+            awesome.set_xproperty("_TEST_EVENT_STORM", i)
+        end
+        return true
+    end,
+
+    function(count)
+        if on_drawin + on_root < EVENTS then
+            if count < 20 then return end
+            error(string.format("only %d of %d events handled", on_drawin + on_root, EVENTS))
+        end
+        assert(on_drawin == EVENTS / 2, on_drawin)
+        assert(on_root == EVENTS / 2, on_root)
+
+        local stats = awesome.loop_stats().events
+        print(string.format("%d events: %.3f ms, %.3f us/event",
+            EVENTS, stats.total * 1e3, stats.total * 1e6 / EVENTS))
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
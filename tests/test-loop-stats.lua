@@ -0,0 +1,40 @@
+-- Test the main loop timing statistics
+
+local runner = require("_runner")
+
+local phases = { "signals", "refresh", "drawin", "client", "banning", "stack", "destroy_later",
+                 "flush", "poll", "events" }
+
+local before
+
+local steps = {
+    function()
+        local stats = awesome.loop_stats(true)
+        before = stats.flush.count
+        for _, name in ipairs(phases) do
+            local phase = stats[name]
+            assert(phase, name)
+            assert(phase.count > 0, name)
+            assert(phase.max <= phase.total, name)
+
+            local sum = 0
+            for _, n in ipairs(phase.buckets) do
+                sum = sum + n
+            end
+            assert(sum == phase.count, name)
+        end
+        return true
+    end,
+
+    -- Everything got reset, only iterations since then are left
+    function()
+        local stats = awesome.loop_stats()
+        assert(stats.flush.count > 0)
+        assert(stats.flush.count < before, stats.flush.count)
+        return true
+    end,
+}
+
+runner.run_steps(steps)
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,217 @@
+/*
+ * A test for the pixel format conversion kernels.
+ *
+ * Copyright © 2023 Abigail Teague <ateague063@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "common/pixel.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * This program checks that every implementation of the conversions in
+ * common/pixel.c gives exactly the same result as the conversion loops
+ * draw.c had before, for every combination of alpha and color value and for
+ * lengths which do not fill a whole vector. Then it prints how many
+ * megapixels per second each implementation converts.
+ */
+
+/* Every alpha value combined with every color value */
+#define CHECK_PIXELS (256 * 256)
+#define BENCH_PIXELS (4096 * 1024)
+#define BENCH_ROUNDS 8
+
+static bool had_error = false;
+
+static void reference_argb(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint8_t a = (src[i] >> 24) & 0xff;
+        double alpha = a / 255.0;
+        uint8_t r = ((src[i] >> 16) & 0xff) * alpha;
+        uint8_t g = ((src[i] >> 8) & 0xff) * alpha;
+        uint8_t b = ((src[i] >> 0) & 0xff) * alpha;
+        dst[i] = ((uint32_t) a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+static void reference_rgba(uint32_t *dst, const uint8_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint8_t r = *src++;
+        uint8_t g = *src++;
+        uint8_t b = *src++;
+        uint8_t a = *src++;
+        double alpha = a / 255.0;
+        r = r * alpha;
+        g = g * alpha;
+        b = b * alpha;
+        dst[i] = ((uint32_t) a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+static void reference_rgb(uint32_t *dst, const uint8_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint8_t r = *src++;
+        uint8_t g = *src++;
+        uint8_t b = *src++;
+        dst[i] = (r << 16) | (g << 8) | b;
+    }
+}
+
+static void fill(uint32_t *argb, uint8_t *rgba, uint8_t *rgb, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint8_t a = i >> 8;
+        uint8_t r = i;
+        uint8_t g = 255 - r;
+        uint8_t b = r * 7;
+
+        argb[i] = ((uint32_t) a << 24) | (r << 16) | (g << 8) | b;
+        rgba[i * 4 + 0] = rgb[i * 3 + 0] = r;
+        rgba[i * 4 + 1] = rgb[i * 3 + 1] = g;
+        rgba[i * 4 + 2] = rgb[i * 3 + 2] = b;
+        rgba[i * 4 + 3] = a;
+    }
+}
+
+static void compare(const char *impl, const char *what, size_t len,
+        const uint32_t *expected, const uint32_t *got)
+{
+    for (size_t i = 0; i < len; i++)
+        if (expected[i] != got[i]) {
+            printf("ERROR: %s %s, length %zu, pixel %zu: expected %08x, got %08x\n",
+                    impl, what, len, i, expected[i], got[i]);
+            had_error = true;
+            return;
+        }
+}
+
+static void check(pixel_impl_t impl, const uint32_t *argb, const uint8_t *rgba,
+        const uint8_t *rgb)
+{
+    const char *name = pixel_impl_name(impl);
+    uint32_t *expected = calloc(CHECK_PIXELS, sizeof(uint32_t));
+    uint32_t *got = calloc(CHECK_PIXELS, sizeof(uint32_t));
+
+    /* The full range, then short lengths starting at odd offsets so that
+     * the vectors are unaligned and the tails are hit */
+    for (size_t start = 0; start < 20; start++) {
+        size_t len = start ? start : CHECK_PIXELS;
+
+        reference_argb(expected, argb + start, len);
+        memset(got, 0, len * sizeof(uint32_t));
+        pixel_premultiply_argb(got, argb + start, len);
+        compare(name, "ARGB", len, expected, got);
+
+        reference_rgba(expected, rgba + start * 4, len);
+        memset(got, 0, len * sizeof(uint32_t));
+        pixel_premultiply_rgba(got, rgba + start * 4, len);
+        compare(name, "RGBA", len, expected, got);
+
+        reference_rgb(expected, rgb + start * 3, len);
+        memset(got, 0, len * sizeof(uint32_t));
+        pixel_rgb_to_rgb24(got, rgb + start * 3, len);
+        compare(name, "RGB", len, expected, got);
+    }
+
+    free(expected);
+    free(got);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *impl, const char *what, double start)
+{
+    double mpixels = (double) BENCH_PIXELS * BENCH_ROUNDS / 1e6;
+
+    printf("LOG: %-6s %-4s %8.1f Mpixel/s\n", impl, what, mpixels / (now() - start));
+}
+
+static void bench(pixel_impl_t impl)
+{
+    const char *name = pixel_impl_name(impl);
+    uint32_t *argb = calloc(BENCH_PIXELS, sizeof(uint32_t));
+    uint8_t *rgba = calloc(BENCH_PIXELS, 4);
+    uint8_t *rgb = calloc(BENCH_PIXELS, 3);
+    uint32_t *dst = calloc(BENCH_PIXELS, sizeof(uint32_t));
+    double start;
+
+    fill(argb, rgba, rgb, BENCH_PIXELS);
+
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        pixel_premultiply_argb(dst, argb, BENCH_PIXELS);
+    report(name, "ARGB", start);
+
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        pixel_premultiply_rgba(dst, rgba, BENCH_PIXELS);
+    report(name, "RGBA", start);
+
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        pixel_rgb_to_rgb24(dst, rgb, BENCH_PIXELS);
+    report(name, "RGB", start);
+
+    free(argb);
+    free(rgba);
+    free(rgb);
+    free(dst);
+}
+
+int main(void)
+{
+    /* A few extra pixels for the offset starts */
+    uint32_t *argb = calloc(CHECK_PIXELS + 32, sizeof(uint32_t));
+    uint8_t *rgba = calloc(CHECK_PIXELS + 32, 4);
+    uint8_t *rgb = calloc(CHECK_PIXELS + 32, 3);
+
+    fill(argb, rgba, rgb, CHECK_PIXELS + 32);
+
+    for (pixel_impl_t impl = 0; impl < PIXEL_IMPL_COUNT; impl++) {
+        if (!pixel_set_impl(impl)) {
+            printf("LOG: %s is not supported, skipped\n", pixel_impl_name(impl));
+            continue;
+        }
+        check(impl, argb, rgba, rgb);
+        bench(impl);
+    }
+
+    free(argb);
+    free(rgba);
+    free(rgb);
+
+    if (had_error)
+        return 1;
+
+    printf("SUCCESS\n");
+    return 0;
+}
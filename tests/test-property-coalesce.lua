@@ -0,0 +1,58 @@
+-- Test that property signals can be coalesced per main loop iteration
+
+local runner = require("_runner")
+
+local MOVES = 5
+
+local w = drawin {
+    x = 10,
+    y = 10,
+    width = 10,
+    height = 10,
+    visible = true,
+}
+
+local moved, resized, before = 0, 0, nil
+
+w:connect_signal("property::x", function() moved = moved + 1 end)
+w:connect_signal("property::geometry", function() resized = resized + 1 end)
+
+runner.run_steps({
+    function()
+        -- Signals are emitted right away by default
+        w.x = 20
+        assert(moved == 1, moved)
+        assert(resized == 1, resized)
+
+        awesome.set_property_signal_coalescing(true)
+        before = awesome._coalesce_count.property_signal
+        moved, resized = 0, 0
+        for i = 1, MOVES do
+            w.x = 20 + i
+        end
+        assert(moved == 0, moved)
+        assert(resized == 0, resized)
+        assert(w.x == 20 + MOVES)
+        return true
+    end,
+
+    function()
+        -- Every change after the first one was dropped
+        assert(moved == 1, moved)
+        assert(resized == 1, resized)
+        local dropped = awesome._coalesce_count.property_signal - before
+        assert(dropped >= 2 * (MOVES - 1), dropped)
+
+        -- Disabling emits what is still recorded
+        w.x = 10
+        assert(moved == 1, moved)
+        awesome.set_property_signal_coalescing(false)
+        assert(moved == 2, moved)
+
+        w.x = 20
+        assert(moved == 3, moved)
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,56 @@
+-- Test that repeated changes of a client property within one batch of events
+-- are only handled once
+
+local runner = require("_runner")
+local test_client = require("_client")
+
+local CHANGES = 20
+
+local c, before = nil, nil
+local notified = 0
+
+awesome.register_xproperty("_TEST_PROPERTY_NOTIFY", "string")
+
+runner.run_steps({
+    function(count)
+        if count == 1 then
+            test_client()
+        end
+        c = client.get()[1]
+        return c
+    end,
+
+    function()
+        c:connect_signal("xproperty::_TEST_PROPERTY_NOTIFY", function()
+            notified = notified + 1
+        end)
+
+        before = awesome._coalesce_count
+        assert(before.property_notify)
+
+        for i = 1, CHANGES do
+            c:set_xproperty("_TEST_PROPERTY_NOTIFY", tostring(i))
+        end
+        return true
+    end,
+
+    function(count)
+        local dropped = awesome._coalesce_count.property_notify - before.property_notify
+
+        -- Every change is either handled or dropped
+        if notified + dropped < CHANGES then
+            if count < 10 then return end
+            error(string.format("%d changes handled, %d dropped", notified, dropped))
+        end
+        assert(notified + dropped == CHANGES, notified)
+        assert(notified >= 1)
+
+        -- The value read afterwards is the last one
+        assert(c:get_xproperty("_TEST_PROPERTY_NOTIFY") == tostring(CHANGES))
+
+        print(string.format("%d of %d changes dropped", dropped, CHANGES))
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
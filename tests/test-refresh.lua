@@ -0,0 +1,54 @@
+-- Test that the refresh phases only process objects which changed
+
+local runner = require("_runner")
+local test_client = require("_client")
+local wibox = require("wibox")
+
+local w, before
+
+local steps = {
+    -- Spawn some clients
+    function(count)
+        if count == 1 then
+            for _ = 1, 5 do
+                test_client()
+            end
+        end
+        if #client.get() >= 5 then
+            w = wibox { x = 10, y = 10, width = 20, height = 20, visible = true }
+            return true
+        end
+    end,
+
+    -- Moving a wibox only refreshes that wibox
+    function()
+        before = awesome._refresh_count
+        w.x = w.x + 10
+        return true
+    end,
+
+    function()
+        local after = awesome._refresh_count
+        assert(after.drawin - before.drawin == 1, after.drawin - before.drawin)
+        assert(after.geometry == before.geometry, after.geometry - before.geometry)
+        assert(after.border == before.border, after.border - before.border)
+
+        -- Changing the border of a single client only refreshes that client
+        before = after
+        client.get()[1].border_width = client.get()[1].border_width + 1
+        return true
+    end,
+
+    function()
+        local after = awesome._refresh_count
+        assert(after.border - before.border == 1, after.border - before.border)
+        assert(after.geometry - before.geometry <= 1, after.geometry - before.geometry)
+        assert(after.drawin == before.drawin, after.drawin - before.drawin)
+        w.visible = false
+        return true
+    end,
+}
+
+runner.run_steps(steps)
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,39 @@
+-- Test that restacking only sends requests for windows that moved
+
+local runner = require("_runner")
+local test_client = require("_client")
+
+local steps = {
+    -- Spawn some clients
+    function(count)
+        if count == 1 then
+            for _ = 1, 5 do
+                test_client()
+            end
+        end
+        if #client.get() >= 5 then
+            return true
+        end
+    end,
+
+    function()
+        client.get()[3]:lower()
+        return true
+    end,
+
+    -- Moving a single client to the bottom must not restack everything
+    function()
+        assert(awesome._restack_count == 1, awesome._restack_count)
+        client.get()[3]:raise()
+        return true
+    end,
+
+    function()
+        assert(awesome._restack_count == 1, awesome._restack_count)
+        return true
+    end,
+}
+
+runner.run_steps(steps)
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,34 @@
+-- Test recording a trace of the main loop
+
+local runner = require("_runner")
+
+local path = os.tmpname()
+
+local steps = {
+    function()
+        assert(awesome.trace_start(path))
+        assert(not awesome.trace_start(path))
+        awesome.connect_signal("test::trace", function() end)
+        awesome.emit_signal("test::trace")
+        return true
+    end,
+
+    function()
+        assert(awesome.trace_stop())
+        assert(not awesome.trace_stop())
+
+        local f = assert(io.open(path))
+        local trace = f:read("a")
+        f:close()
+        os.remove(path)
+
+        assert(trace:find('"traceEvents"', 1, true))
+        assert(trace:find('"name":"test::trace","cat":"signal"', 1, true))
+        assert(trace:find('"name":"flush","cat":"loop"', 1, true))
+        return true
+    end,
+}
+
+runner.run_steps(steps)
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
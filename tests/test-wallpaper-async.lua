@@ -0,0 +1,66 @@
+-- Test that setting the wallpaper happens without blocking the main loop
+
+local runner = require("_runner")
+local get_pixel = require("_pixel").get_pixel
+local color = require("gears.color")
+
+local changed = 0
+awesome.connect_signal("wallpaper_changed", function() changed = changed + 1 end)
+
+local width, height = root.size()
+
+runner.run_steps({
+    function()
+        awesome.loop_stats(true)
+        assert(root.wallpaper(color("#ff0000")))
+        -- Nothing happened yet
+        assert(changed == 0)
+        return true
+    end,
+
+    function()
+        if changed == 0 then return end
+        assert(changed == 1)
+
+        assert(get_pixel(root.wallpaper(), 0, 0) == "#ff0000")
+        assert(get_pixel(root.wallpaper(), width - 1, height - 1) == "#ff0000")
+
+        -- Painting was split into slices outside of the main loop phases
+        local stats = awesome.loop_stats().wallpaper
+        assert(stats.count >= 1)
+        print(string.format("wallpaper: %d slices, longest %.3f ms",
+            stats.count, stats.max * 1e3))
+
+        -- A wallpaper replacing one which is still painted wins
+        changed = 0
+        assert(root.wallpaper(color("#00ff00")))
+        assert(root.wallpaper(color("#0000ff")))
+        return true
+    end,
+
+    function()
+        if changed == 0 then return end
+        assert(changed == 1)
+        assert(get_pixel(root.wallpaper(), 0, 0) == "#0000ff")
+
+        -- Getting the wallpaper finishes painting the one being set
+        changed = 0
+        assert(root.wallpaper(color("#00ff00")))
+        assert(get_pixel(root.wallpaper(), width - 1, height - 1) == "#00ff00")
+        return true
+    end,
+
+    function()
+        -- The signal still comes from the main loop, exactly once
+        if changed == 0 then return end
+        assert(changed == 1)
+        return true
+    end,
+
+    function()
+        assert(changed == 1)
+        return true
+    end,
+})
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80